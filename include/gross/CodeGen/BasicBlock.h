@@ -1,10 +1,10 @@
 #ifndef GROSS_CODEGEN_BASICBLOCK_H
 #define GROSS_CODEGEN_BASICBLOCK_H
 #include "gross/Graph/Node.h"
+#include "gross/Graph/NodeMap.h"
 #include "gross/Support/iterator_range.h"
 #include <list>
 #include <utility>
-#include <unordered_map>
 #include <iostream>
 
 namespace gross {
@@ -65,20 +65,38 @@ struct BasicBlock {
     }
   };
 
+  // position of a linearlized Node
+  struct NodeOrder {
+    BasicBlock* Owner;
+    SeqNodeId Id;
+    // sparse, increasing along the sequence. Renumbered lazily
+    // if there is no gap left for new Node
+    uint32_t Ordinal;
+
+    NodeOrder() : Owner(nullptr), Ordinal(0U) {}
+  };
+  // shared by all the blocks of a GraphSchedule
+  using order_map_type = NodeMap<NodeOrder>;
+
 private:
   Id BlockId;
 
   // first Node is always the control op of this block
   std::list<Node*> NodeSequence;
-  std::unordered_map<Node*, SeqNodeId> NodeIds;
+  order_map_type& NodeOrders;
   SeqNodeId LastNodeId;
 
+  static constexpr uint32_t OrdinalStride = 1U << 8;
+  void RenumberNodes();
+
   std::vector<BasicBlock*> Predecessors;
   std::vector<BasicBlock*> Successors;
 
 public:
-  BasicBlock(const Id& BBId = Id::Create(0U))
+  explicit BasicBlock(order_map_type& Orders,
+                      const Id& BBId = Id::Create(0U))
     : BlockId(BBId),
+      NodeOrders(Orders),
       LastNodeId(SeqNodeId::Create(0U)) {}
 
   const Id& getId() const { return BlockId; }
@@ -137,9 +155,18 @@ public:
     return llvm::make_range(node_rbegin(), node_rend());
   }
 
-  SeqNodeId* getNodeId(Node* N) const;
+  const SeqNodeId* getNodeId(Node* N) const {
+    if(!NodeOrders.count(N) || NodeOrders.at(N).Owner != this)
+      return nullptr;
+    return &NodeOrders.at(N).Id;
+  }
 
-  size_t getNodeIndex(Node* N) const;
+  // O(1) program order comparison between Nodes in this block
+  uint32_t getNodeOrdinal(Node* N) const {
+    assert(NodeOrders.count(N) && NodeOrders.at(N).Owner == this &&
+           "Node is not in BB?");
+    return NodeOrders.at(N).Ordinal;
+  }
 
 private:
   // Since GraphSchedule is the one managing other BB properties
@@ -4,6 +4,7 @@
 #include "boost/iterator/transform_iterator.hpp"
 #include "gross/CodeGen/BasicBlock.h"
 #include "gross/Graph/Graph.h"
+#include "gross/Graph/NodeMap.h"
 #include "gross/Graph/NodeMarker.h"
 #include "gross/Support/iterator_range.h"
 #include "gross/Support/STLExtras.h"
@@ -21,38 +22,49 @@ class GraphSchedule {
   // owner of basic blocks
   // must be in RPO order
   std::vector<std::unique_ptr<BasicBlock>> Blocks;
-  std::unordered_map<Node*, BasicBlock*> Node2Block;
+  NodeMap<BasicBlock*> Node2Block;
+  // orders of nodes within their blocks
+  BasicBlock::order_map_type NodeOrders;
   std::vector<Node*> RPONodes;
 
   struct RPONodesVisitor;
+  struct BackEdgePatcher;
   void SortRPONodes();
 
   class DominatorNode {
     BasicBlock* ThisBlock;
     std::vector<BasicBlock*> Dominants;
     BasicBlock* Dominator;
+    // pre/post order numbers in the dominator tree
+    unsigned DFSIn, DFSOut;
+    unsigned Depth;
 
   public:
     explicit DominatorNode(BasicBlock* ThisBB)
-      : ThisBlock(ThisBB), Dominator(nullptr) {}
+      : ThisBlock(ThisBB), Dominator(nullptr),
+        DFSIn(0U), DFSOut(0U), Depth(0U) {}
 
     BasicBlock* getBlock() const { return ThisBlock; }
 
     void setDominator(BasicBlock* BB) { Dominator = BB; }
     BasicBlock* getDominator() { return Dominator; }
 
-    void AddDomChild(BasicBlock* DN) { Dominants.push_back(DN); }
-    bool RemoveDomChild(BasicBlock* DN) {
-      auto It
-        = gross::find_if(doms(),
-                         [=](BasicBlock* BB) -> bool {
-                           return BB == DN;
-                         });
-      if(It == dom_end()) return false;
-      Dominants.erase(It);
-      return true;
+    void setDFSNumbers(unsigned In, unsigned Out) {
+      DFSIn = In;
+      DFSOut = Out;
+    }
+    unsigned getDFSIn() const { return DFSIn; }
+    unsigned getDFSOut() const { return DFSOut; }
+    // True if this node is an ancestor of (or the same as) Other
+    bool DominatedBy(const DominatorNode& Other) const {
+      return Other.DFSIn <= DFSIn && DFSOut <= Other.DFSOut;
     }
 
+    void setDepth(unsigned D) { Depth = D; }
+    unsigned getDepth() const { return Depth; }
+
+    void AddDomChild(BasicBlock* DN) { Dominants.push_back(DN); }
+
     using dom_iterator = typename decltype(Dominants)::iterator;
     using const_dom_iterator = typename decltype(Dominants)::const_iterator;
     dom_iterator dom_begin() { return Dominants.begin(); }
@@ -66,16 +78,12 @@ class GraphSchedule {
       return llvm::make_range(dom_cbegin(), dom_cend());
     }
     size_t dom_size() const { return Dominants.size(); }
-
-    struct subdom_iterator;
   };
   using DomNodesTy
     = std::unordered_map<BasicBlock*, std::unique_ptr<DominatorNode>>;
   DomNodesTy DomNodes;
 
-  DominatorNode::subdom_iterator subdom_begin(BasicBlock* BB);
-
-  void ChangeDominator(BasicBlock* BB, BasicBlock* NewDomBB);
+  void ComputeLoopTree();
 
   class LoopTreeNode {
     BasicBlock* Header;
@@ -277,7 +285,7 @@ public:
 
   Node* MapBlockOffset(BasicBlock* BB) {
     if(!BlockOffsets.find_node(BB)) {
-      auto* N = new Node(IrOpcode::DLXOffset, {});
+      auto* N = new (G) Node(IrOpcode::DLXOffset, {});
       G.InsertNode(N);
       BlockOffsets.insert({N, BB});
     }
@@ -293,15 +301,27 @@ public:
   class TreeHandle;
 
   struct DomTreeProxy;
-  bool Dominate(BasicBlock* FromBB, BasicBlock* ToBB);
+  // build the DomTree and LoopTree. Should be called
+  // once the CFG is built
+  void ComputeDominatorTree();
+  // O(1) query with the DFS numbers of DomTree
+  bool Dominate(BasicBlock* FromBB, BasicBlock* ToBB) {
+    if(!DomNodes.count(FromBB) ||
+       !DomNodes.count(ToBB)) return false;
+    return DomNodes.at(ToBB)->DominatedBy(*DomNodes.at(FromBB));
+  }
   BasicBlock* getDominator(BasicBlock* BB) {
     if(DomNodes.count(BB))
       return DomNodes[BB]->getDominator();
     else
       return nullptr;
   }
-  // notify the DomTree to update
-  void OnConnectBlock(BasicBlock* Pred, BasicBlock* Succ);
+  unsigned getDomDepth(BasicBlock* BB) {
+    assert(DomNodes.count(BB));
+    return DomNodes.at(BB)->getDepth();
+  }
+  // nearest common dominator of two blocks
+  BasicBlock* getCommonDominator(BasicBlock* BB1, BasicBlock* BB2);
 
   struct LoopTreeProxy;
   bool IsLoopHeader(BasicBlock* BB) { return LoopTree.count(BB); }
@@ -27,12 +27,7 @@ struct graph_traits<gross::Graph> {
   }
 
   /// VertexListGraphConcept
-  using vertex_iterator
-    = boost::transform_iterator<gross::unique_ptr_unwrapper<gross::Node>,
-                                typename gross::Graph::node_iterator,
-                                gross::Node*, // Refrence type
-                                gross::Node* // Value type
-                                >;
+  using vertex_iterator = typename gross::Graph::node_iterator;
   using vertices_size_type = size_t;
 
   /// EdgeListGraphConcept
@@ -89,6 +84,37 @@ struct graph_traits<gross::SubGraph> {
     public boost::incidence_graph_tag {};
 };
 
+template<class PatcherT>
+struct graph_traits<gross::PatchedSubGraph<PatcherT>> {
+  /// GraphConcept
+  using vertex_descriptor = gross::Node*;
+  using edge_descriptor = gross::Use;
+  using directed_category = boost::directed_tag;
+  using edge_parallel_category = boost::allow_parallel_edge_tag;
+
+  static vertex_descriptor null_vertex() {
+    return nullptr;
+  }
+
+  /// VertexListGraphConcept
+  using vertex_iterator = typename gross::SubGraph::node_iterator;
+  using vertices_size_type = size_t;
+
+  /// IncidenceGraphConcept
+  using out_edge_iterator
+    = boost::transform_iterator<
+        typename gross::Use::template PatchedBuilderFunctor<PatcherT>,
+        typename gross::Node::input_iterator,
+        gross::Use, // Reference type
+        gross::Use // Value type
+      >;
+  using degree_size_type = size_t;
+
+  struct traversal_category :
+    public boost::vertex_list_graph_tag,
+    public boost::incidence_graph_tag {};
+};
+
 /// Note: We mark most of the BGL trait functions here as inline
 /// because they're trivial.
 /// FIXME: Will putting them into separated source file helps reducing
@@ -99,13 +125,7 @@ inline
 std::pair<typename boost::graph_traits<gross::Graph>::vertex_iterator,
           typename boost::graph_traits<gross::Graph>::vertex_iterator>
 vertices(gross::Graph& g) {
-  using vertex_it_t
-    = typename boost::graph_traits<gross::Graph>::vertex_iterator;
-  gross::unique_ptr_unwrapper<gross::Node> functor;
-  return std::make_pair(
-    vertex_it_t(g.node_begin(), functor),
-    vertex_it_t(g.node_end(), functor)
-  );
+  return std::make_pair(g.node_begin(), g.node_end());
 }
 inline
 std::pair<typename boost::graph_traits<gross::Graph>::vertex_iterator,
@@ -218,8 +238,7 @@ out_edges(gross::Node* u, const T& g) {
   // for now, we don't care about the kind of edge
   using edge_it_t
     = typename boost::graph_traits<T>::out_edge_iterator;
-  gross::Use::BuilderFunctor functor(u, gross::Use::K_NONE,
-                                     g.GetEdgePatcher());
+  gross::Use::BuilderFunctor functor(u, gross::Use::K_NONE);
   return std::make_pair(
     edge_it_t(u->inputs().begin(), functor),
     edge_it_t(u->inputs().end(), functor)
@@ -236,6 +255,52 @@ out_degree(gross::Node* u, const T& g) {
          + u->getNumControlInput()
          + u->getNumEffectInput();
 }
+
+/// PatchedSubGraph
+template<class PatcherT>
+inline
+std::pair<typename gross::SubGraph::node_iterator,
+          typename gross::SubGraph::node_iterator>
+vertices(const gross::PatchedSubGraph<PatcherT>& g) {
+  return std::make_pair(g.node_begin(), g.node_end());
+}
+template<class PatcherT>
+inline size_t num_vertices(const gross::PatchedSubGraph<PatcherT>& g) {
+  return g.node_size();
+}
+template<class PatcherT>
+inline gross::Node*
+source(const gross::Use& e, const gross::PatchedSubGraph<PatcherT>& g) {
+  return const_cast<gross::Node*>(e.Source);
+}
+template<class PatcherT>
+inline gross::Node*
+target(const gross::Use& e, const gross::PatchedSubGraph<PatcherT>& g) {
+  return const_cast<gross::Node*>(e.Dest);
+}
+template<class PatcherT>
+inline
+std::pair<
+  typename graph_traits<gross::PatchedSubGraph<PatcherT>>::out_edge_iterator,
+  typename graph_traits<gross::PatchedSubGraph<PatcherT>>::out_edge_iterator>
+out_edges(gross::Node* u, const gross::PatchedSubGraph<PatcherT>& g) {
+  using edge_it_t
+    = typename graph_traits<gross::PatchedSubGraph<PatcherT>>
+               ::out_edge_iterator;
+  typename gross::Use::template PatchedBuilderFunctor<PatcherT>
+    functor(u, gross::Use::K_NONE);
+  return std::make_pair(
+    edge_it_t(u->inputs().begin(), functor),
+    edge_it_t(u->inputs().end(), functor)
+  );
+}
+template<class PatcherT>
+inline size_t
+out_degree(gross::Node* u, const gross::PatchedSubGraph<PatcherT>& g) {
+  return u->getNumValueInput()
+         + u->getNumControlInput()
+         + u->getNumEffectInput();
+}
 } // end namespace boost
 
 /// Property Map Concept
@@ -250,14 +315,7 @@ struct graph_id_map<GraphT, boost::vertex_index_t> {
   graph_id_map(const GraphT& g) : G(g) {}
 
   reference operator[](const key_type& key) const {
-    // just use linear search for now
-    // TODO: improve time complexity
-    value_type Idx = 0;
-    for(auto I = G.node_cbegin(), E = G.node_cend();
-        I != E; ++I, ++Idx) {
-      if(GraphT::GetNodeFromIt(I) == key) break;
-    }
-    return Idx;
+    return G.getNodeIndex(key);
   }
 
 private:
@@ -286,6 +344,42 @@ inline gross::enable_if_t<
 get(boost::vertex_index_t tag, const GraphT& g) {
   return gross::graph_id_map<GraphT,boost::vertex_index_t>(g);
 }
+
+// so that algorithms can create vector-backed property maps
+// (e.g. color map) by default
+template<>
+struct property_map<gross::Graph, boost::vertex_index_t> {
+  using type = gross::graph_id_map<gross::Graph, boost::vertex_index_t>;
+  using const_type = type;
+};
+template<>
+struct property_map<gross::SubGraph, boost::vertex_index_t> {
+  using type = gross::graph_id_map<gross::SubGraph, boost::vertex_index_t>;
+  using const_type = type;
+};
+
+// PatchedSubGraph shares vertex index with the underlying SubGraph
+template<class PatcherT>
+inline typename gross::graph_id_map<gross::SubGraph,
+                                    boost::vertex_index_t>::reference
+get(const gross::graph_id_map<gross::PatchedSubGraph<PatcherT>,
+                              boost::vertex_index_t> &pmap,
+    gross::Node* key) {
+  return pmap[key];
+}
+template<class PatcherT>
+inline gross::graph_id_map<gross::PatchedSubGraph<PatcherT>,
+                           boost::vertex_index_t>
+get(boost::vertex_index_t tag, const gross::PatchedSubGraph<PatcherT>& g) {
+  return gross::graph_id_map<gross::PatchedSubGraph<PatcherT>,
+                             boost::vertex_index_t>(g);
+}
+template<class PatcherT>
+struct property_map<gross::PatchedSubGraph<PatcherT>, boost::vertex_index_t> {
+  using type = gross::graph_id_map<gross::PatchedSubGraph<PatcherT>,
+                                   boost::vertex_index_t>;
+  using const_type = type;
+};
 } // end namespace boost
 
 /// PropertyWriter Concept
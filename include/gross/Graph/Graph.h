@@ -1,11 +1,16 @@
 #ifndef GROSS_GRAPH_GRAPH_H
 #define GROSS_GRAPH_GRAPH_H
+#include "gross/Support/Allocator.h"
 #include "gross/Support/iterator_range.h"
 #include "gross/Support/Graph.h"
 #include "gross/Graph/Node.h"
+#include "gross/Graph/NodeMap.h"
 #include "gross/Graph/Attribute.h"
+#include <array>
 #include <memory>
+#include <mutex>
 #include <iostream>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -16,44 +21,92 @@ class SubGraph {
   template<class T>
   friend struct std::hash;
 
-  // only hold the tail node, lazily travel the graph when needed
+  // only hold the tail node, nodes are collected
+  // (and cached) when needed
   Node* TailNode;
 
-  typename Use::BuilderFunctor::PatcherTy EdgePatcher;
+  // node lists shared by all copies of this SubGraph
+  struct NodeCache {
+    bool Valid, HasPO;
+    // BFS order starting from the tail node
+    std::vector<Node*> BFSNodes;
+    // post order of DFS starting from the tail node
+    std::vector<Node*> PONodes;
+    // node id -> index in BFSNodes, ~0U if absent
+    std::vector<uint32_t> Indices;
+
+    NodeCache() : Valid(false), HasPO(false) {}
+  };
+  std::shared_ptr<NodeCache> Cache;
+
+  NodeCache& getCache() const;
+  NodeCache& getPOCache() const;
 
 public:
-  SubGraph() : TailNode(nullptr), EdgePatcher(nullptr) {}
+  SubGraph() : TailNode(nullptr) {}
 
-  explicit SubGraph(Node* Tail) : TailNode(Tail) {}
+  explicit SubGraph(Node* Tail)
+    : TailNode(Tail),
+      Cache(std::make_shared<NodeCache>()) {}
 
   bool operator==(const SubGraph& Other) const {
     return TailNode == Other.TailNode;
   }
 
-  void SetEdgePatcher(Use::BuilderFunctor::PatcherTy Patcher) {
-    EdgePatcher = Patcher;
-  }
-  void ClearEdgePatcher() { EdgePatcher = nullptr; }
-  const Use::BuilderFunctor::PatcherTy& GetEdgePatcher() const {
-    return EdgePatcher;
+  Node* getTail() const { return TailNode; }
+
+  // The node lists are computed lazily and cached. Passes that
+  // change edges inside this SubGraph need to call this afterward.
+  // Note that all copies of this SubGraph are invalidated as well
+  void InvalidateNodes() const {
+    if(Cache) {
+      Cache->Valid = Cache->HasPO = false;
+      Cache->BFSNodes.clear();
+      Cache->PONodes.clear();
+      Cache->Indices.clear();
+    }
   }
 
-  using node_iterator = lazy_node_iterator<SubGraph, false>;
-  using const_node_iterator = lazy_node_iterator<SubGraph, true>;
+  // in BFS order starting from the tail node
+  using node_iterator = typename std::vector<Node*>::iterator;
+  using const_node_iterator = typename std::vector<Node*>::const_iterator;
   static Node* GetNodeFromIt(const node_iterator& NodeIt) { return *NodeIt; }
   static const Node* GetNodeFromIt(const const_node_iterator& NodeIt) {
     return *NodeIt;
   }
-  node_iterator node_begin() { return node_iterator(TailNode); }
-  node_iterator node_end() { return node_iterator(); }
+  node_iterator node_begin() { return getCache().BFSNodes.begin(); }
+  node_iterator node_end() { return getCache().BFSNodes.end(); }
   llvm::iterator_range<node_iterator> nodes() {
     return llvm::make_range(node_begin(), node_end());
   }
   const_node_iterator node_cbegin() const {
-    return const_node_iterator(const_cast<const Node*>(TailNode));
+    return getCache().BFSNodes.cbegin();
+  }
+  const_node_iterator node_cend() const {
+    return getCache().BFSNodes.cend();
+  }
+  size_t node_size() const { return getCache().BFSNodes.size(); }
+  // dense index in [0, node_size()), used as vertex_index
+  size_t getNodeIndex(const Node* N) const {
+    const auto& Indices = getCache().Indices;
+    assert(N->getId() < Indices.size() && Indices[N->getId()] != ~0U &&
+           "Node not in this SubGraph");
+    return Indices[N->getId()];
+  }
+
+  // DFS post order / reverse post order starting from the tail node
+  using po_iterator = typename std::vector<Node*>::iterator;
+  using rpo_iterator = typename std::vector<Node*>::reverse_iterator;
+  po_iterator po_begin() { return getPOCache().PONodes.begin(); }
+  po_iterator po_end() { return getPOCache().PONodes.end(); }
+  llvm::iterator_range<po_iterator> po_nodes() {
+    return llvm::make_range(po_begin(), po_end());
+  }
+  rpo_iterator rpo_begin() { return getPOCache().PONodes.rbegin(); }
+  rpo_iterator rpo_end() { return getPOCache().PONodes.rend(); }
+  llvm::iterator_range<rpo_iterator> rpo_nodes() {
+    return llvm::make_range(rpo_begin(), rpo_end());
   }
-  const_node_iterator node_cend() const { return const_node_iterator(); }
-  size_t node_size() const;
 
   using edge_iterator = lazy_edge_iterator<SubGraph>;
   edge_iterator edge_begin();
@@ -61,6 +114,28 @@ public:
   size_t edge_size();
   size_t edge_size() const { return const_cast<SubGraph*>(this)->edge_size(); }
 };
+
+/// View of a SubGraph whose edges are rewritten by PatcherT, a stateless
+/// function object with signature Use(const Use&). For example, reversing
+/// back edges during DFS. Since the patcher is resolved at compile time,
+/// plain SubGraph traversals don't pay for it.
+template<class PatcherT>
+class PatchedSubGraph {
+  SubGraph& SG;
+
+public:
+  using patcher_type = PatcherT;
+
+  explicit PatchedSubGraph(SubGraph& G) : SG(G) {}
+
+  SubGraph& getSubGraph() const { return SG; }
+
+  using node_iterator = typename SubGraph::node_iterator;
+  node_iterator node_begin() const { return SG.node_begin(); }
+  node_iterator node_end() const { return SG.node_end(); }
+  size_t node_size() const { return SG.node_size(); }
+  size_t getNodeIndex(const Node* N) const { return SG.getNodeIndex(N); }
+};
 } // end namespace gross
 
 namespace std {
@@ -88,8 +163,20 @@ class Graph {
   friend struct NodeProperties;
   friend class NodeMarkerBase;
   friend struct AttributeBuilder;
+  friend class Node;
 
-  std::vector<std::unique_ptr<Node>> Nodes;
+  // owner of all the nodes' storage. Put it first so
+  // it will be destructed last
+  SpecificBumpAllocator<Node> NodeAllocator;
+  // storage of nodes built concurrently, one per thread
+  std::vector<std::unique_ptr<SpecificBumpAllocator<Node>>> ThreadAllocators;
+
+  std::vector<Node*> Nodes;
+  // next dense node id
+  uint32_t NextNodeId;
+  // node -> index in Nodes, lazily computed
+  mutable NodeMap<uint32_t> NodeIndices;
+  mutable bool NodeIndicesValid;
 
   // Constant pools
   NodeBiMap<std::string> ConstStrPool;
@@ -105,13 +192,60 @@ class Graph {
   // attribute storage (owner of attribute implements)
   // Node where attribute attached -> list of Attribute implement
   using AttributeList = std::list<std::unique_ptr<AttributeConcept>>;
-  std::unordered_map<Node*, AttributeList> Attributes;
+  NodeMap<AttributeList> Attributes;
   std::unordered_set<Node*> GlobalVariables;
 
-  // recording state of NodeMarkers
-  typename Node::MarkerTy MarkerMax;
+  // opt-in hash-consing table of pure binary nodes.
+  // Entries might be stale, they're validated upon lookup
+  struct ValueNumberKey {
+    IrOpcode::ID Op;
+    Node *LHS, *RHS;
+
+    bool operator==(const ValueNumberKey& Other) const {
+      return Op == Other.Op && LHS == Other.LHS && RHS == Other.RHS;
+    }
+  };
+  struct ValueNumberKeyHash {
+    size_t operator()(const ValueNumberKey& Key) const;
+  };
+  bool ValueNumbering;
+  using ValueNumberMap
+    = std::unordered_map<ValueNumberKey, Node*, ValueNumberKeyHash>;
+  ValueNumberMap ValueNumbers;
+  // return false if the node is not eligible
+  bool MakeValueNumberKey(IrOpcode::ID Op, Node* LHS, Node* RHS,
+                          ValueNumberKey& Key) const;
 
-  typename Use::BuilderFunctor::PatcherTy EdgePatcher;
+  // true between DetachSharedNodes and AttachSharedNodes
+  bool SharedNodesDetached;
+  // see SetFunctionLocal
+  bool FunctionLocal;
+  // index of the function each node belongs to
+  static constexpr uint32_t NoOwner = ~0U, SharedOwner = ~1U;
+  std::vector<uint32_t> computeOwners();
+
+  // state of concurrent node building
+  struct ConcurrentBuildState;
+  std::unique_ptr<ConcurrentBuildState> ConcurrentBuild;
+  // guard of the constant and function stub pools
+  mutable std::mutex PoolMutex;
+
+  // nullptr if the current thread is not in a BuildScope of this Graph
+  struct FunctionBuildState;
+  static thread_local FunctionBuildState* CurrentBuild;
+  FunctionBuildState* getCurrentBuild() const;
+  // lock the pools if nodes are being built concurrently
+  std::unique_lock<std::mutex> LockPools() const {
+    return ConcurrentBuild? std::unique_lock<std::mutex>(PoolMutex)
+                          : std::unique_lock<std::mutex>();
+  }
+  // record pooled node N that is used by the current function
+  void UsePooledNode(Node* N);
+
+  // recording state of NodeMarkers in each slot
+  std::array<typename Node::MarkerTy, Node::NumMarkerSlots> MarkerMax;
+  // number of active NodeMarkers in each slot
+  std::array<unsigned, Node::NumMarkerSlots> NumActiveMarkers;
 
   // used to marked node index that is inserted in certain
   // period
@@ -119,20 +253,8 @@ class Graph {
   uint16_t NodeIdxCounter;
 
 public:
-  Graph()
-    : DeadNode(nullptr),
-      MarkerMax(0U),
-      EdgePatcher(nullptr),
-      NodeIdxMarker(nullptr),
-      NodeIdxCounter(0U) {}
-
-  void SetEdgePatcher(Use::BuilderFunctor::PatcherTy Patcher) {
-    EdgePatcher = Patcher;
-  }
-  void ClearEdgePatcher() { EdgePatcher = nullptr; }
-  const Use::BuilderFunctor::PatcherTy& GetEdgePatcher() const {
-    return EdgePatcher;
-  }
+  Graph();
+  ~Graph();
 
   void SetNodeIdxMarker(NodeMarker<uint16_t>* Marker) {
     NodeIdxMarker = Marker;
@@ -143,17 +265,22 @@ public:
   using node_iterator = typename decltype(Nodes)::iterator;
   using const_node_iterator = typename decltype(Nodes)::const_iterator;
   static Node* GetNodeFromIt(const node_iterator& NodeIt) {
-    return NodeIt->get();
+    return *NodeIt;
   }
   static const Node* GetNodeFromIt(const const_node_iterator& NodeIt) {
-    return NodeIt->get();
+    return *NodeIt;
   }
   node_iterator node_begin() { return Nodes.begin(); }
   const_node_iterator node_cbegin() const { return Nodes.cbegin(); }
   node_iterator node_end() { return Nodes.end(); }
   const_node_iterator node_cend() const { return Nodes.cend(); }
-  Node* getNode(size_t idx) const { return Nodes.at(idx).get(); }
+  Node* getNode(size_t idx) const { return Nodes.at(idx); }
   size_t node_size() const { return Nodes.size(); }
+  // upper bound (exclusive) of node ids ever assigned
+  size_t getNumNodeIds() const { return NextNodeId; }
+  // dense index in [0, node_size()), used as vertex_index.
+  // Unlike node id, it might change after node removal
+  size_t getNodeIndex(const Node* N) const;
 
   using edge_iterator = lazy_edge_iterator<Graph>;
   edge_iterator edge_begin();
@@ -165,9 +292,94 @@ public:
   llvm::iterator_range<subregion_iterator> subregions() {
     return llvm::make_range(SubRegions.begin(), SubRegions.end());
   }
+  size_t subregion_size() const { return SubRegions.size(); }
+  // drop cached node lists of all functions
+  void InvalidateSubRegions() {
+    for(auto& SG : SubRegions)
+      SG.InvalidateNodes();
+  }
 
   void InsertNode(Node* N);
+  // Note that the storage of removed node will only be
+  // released when the Graph is destructed
   node_iterator RemoveNode(node_iterator It);
+  // Remove all nodes in Marked in one linear pass.
+  // Edges from the remaining nodes to removed nodes or
+  // the Dead node are dropped.
+  // Return the number of removed nodes
+  size_t RemoveNodes(const NodeSet& Marked);
+  // Mark-and-compact: remove every node that satisfies Pred
+  template<class UnaryPred>
+  size_t SweepNodes(UnaryPred Pred) {
+    NodeSet Marked(NextNodeId);
+    for(auto* N : Nodes) {
+      if(N != DeadNode && Pred(N)) Marked.insert(N);
+    }
+    return RemoveNodes(Marked);
+  }
+
+  /// Hash-consing of COMMON_OP binary ops and DLX arithmetic
+  /// ops. When enabled, their NodeBuilder returns an existing
+  /// node with identical opcode and inputs (commutative operands
+  /// are canonicalized). Should be disabled before nodes
+  /// are placed into schedules, where identity matters.
+  void EnableValueNumbering(bool Enable = true) {
+    ValueNumbering = Enable;
+    if(!Enable) ValueNumbers.clear();
+  }
+  bool IsValueNumberingEnabled() const { return ValueNumbering; }
+  // return a live node that is identical to Op(LHS, RHS),
+  // or nullptr if there is none
+  Node* FindValueNumber(IrOpcode::ID Op, Node* LHS, Node* RHS);
+  // make N the representative of its current opcode and inputs.
+  // Return the existing representative if there is one, or N itself
+  Node* AddValueNumber(Node* N);
+
+  /// Shared nodes are the nodes that can be used by more than one
+  /// function: constants, function stubs, the Dead node and
+  /// global variables.
+  bool IsSharedNode(const Node* N) const;
+  /// Other nodes used by more than one function or by shared nodes
+  /// are treated as shared by DetachSharedNodes as well. Return the
+  /// ones without such users, in the order of node id.
+  std::vector<Node*> getCrossFunctionRoots();
+  /// Clear the user lists of shared nodes and stop recording users
+  /// for them, so that functions can be modified without touching
+  /// each other. Shared nodes themselves should not be modified
+  /// until AttachSharedNodes.
+  /// Return false, without detaching anything, if an unreachable
+  /// node uses nodes from different functions.
+  bool DetachSharedNodes();
+  /// Rebuild the user lists of shared nodes. Users are put in
+  /// the order of node id, no matter how they were linked.
+  void AttachSharedNodes();
+  /// Don't value-number nodes whose operands are all shared, which
+  /// is also the case while shared nodes are detached. So functions
+  /// reduced one after another don't start sharing nodes either.
+  void SetFunctionLocal(bool Enable) { FunctionLocal = Enable; }
+
+  /// Build nodes of different functions concurrently. Threads that
+  /// create nodes for the Idx-th function need to stay in a BuildScope
+  /// of it. Nodes created in the scopes get their final ids in
+  /// EndConcurrentBuild, as if the functions were built one after
+  /// another in the order of the functions. Note that other than
+  /// creating nodes, functions still need to be modified independently
+  /// (see DetachSharedNodes).
+  void BeginConcurrentBuild(size_t NumFunctions, size_t NumThreads);
+  void EndConcurrentBuild();
+  bool IsConcurrentBuild() const { return bool(ConcurrentBuild); }
+
+  class BuildScope {
+    FunctionBuildState* PrevBuild;
+
+  public:
+    // ThreadIdx selects the node storage. Each thread
+    // should use a distinct ThreadIdx
+    BuildScope(Graph& G, size_t FunctionIdx, size_t ThreadIdx);
+    BuildScope(const BuildScope&) = delete;
+    BuildScope& operator=(const BuildScope&) = delete;
+    ~BuildScope();
+  };
 
   void MarkGlobalVar(Node* N);
   bool IsGlobalVar(Node* N) const { return GlobalVariables.count(N); }
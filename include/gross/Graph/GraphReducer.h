@@ -3,7 +3,16 @@
 #include "gross/Graph/Graph.h"
 #include "gross/Graph/Node.h"
 #include "gross/Graph/NodeMarker.h"
+#include "gross/Support/Statistics.h"
+#include "gross/Support/STLExtras.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace gross {
 struct GraphReduction {
@@ -23,32 +32,6 @@ private:
 //  { R.Reduce(N) } -> GraphReduction;
 // };
 
-namespace _detail {
-// abstract base class used to dispatch
-// polymorphically over reducer objects
-struct ReducerConcept {
-  virtual const char* name() const = 0;
-
-  virtual GraphReduction Reduce(Node* N) = 0;
-};
-
-// a template wrapper used to implement the polymorphic API
-template<class ReducerT, class... CtorArgs>
-struct ReducerModel : public ReducerConcept {
-  ReducerModel(CtorArgs &&... args)
-    : Reducer(std::forward<CtorArgs>(args)...) {}
-
-  GraphReduction Reduce(Node* N) override {
-    return Reducer.Reduce(N);
-  }
-
-  const char* name() const override { return ReducerT::name(); }
-
-private:
-  ReducerT Reducer;
-};
-} // end namespace _detail
-
 /// Mixin for reducer to modify other nodes
 struct GraphEditor {
   struct Interface {
@@ -84,6 +67,99 @@ protected:
   }
 };
 
+namespace _detail {
+/// Reducers that only modify nodes of the function being reduced,
+/// besides building new nodes, can reduce different functions
+/// concurrently. They are marked by
+///   static constexpr bool IsFunctionLocal = true;
+/// Note that constants, function stubs and global variables are
+/// not part of any function (see Graph::IsSharedNode).
+template<class ReducerT, class = void>
+struct IsFunctionLocalReducer : std::false_type {};
+template<class ReducerT>
+struct IsFunctionLocalReducer<ReducerT,
+                              decltype(void(ReducerT::IsFunctionLocal))>
+  : std::integral_constant<bool, ReducerT::IsFunctionLocal> {};
+
+// construct the reducer with the GraphEditor::Interface
+// if it's a GraphEditor
+template<class ReducerT,
+         bool IsEditor =
+           std::is_constructible<ReducerT, GraphEditor::Interface*>::value>
+struct ReducerHolder {
+  ReducerT Reducer;
+
+  explicit ReducerHolder(GraphEditor::Interface* Editor)
+    : Reducer(Editor) {}
+};
+template<class ReducerT>
+struct ReducerHolder<ReducerT, false> {
+  ReducerT Reducer;
+
+  explicit ReducerHolder(GraphEditor::Interface*) : Reducer() {}
+};
+
+/// Reducers composed at compile time. Each of them is tried in order
+/// on the same node, stopping at the first one that replaces the node.
+/// In-place changes made by earlier reducers are kept and the later
+/// reducers still get the chance to reduce the node.
+template<class... ReducerTs>
+struct ReducerChain {
+  static constexpr bool IsFunctionLocal = true;
+
+  explicit ReducerChain(GraphEditor::Interface*) {}
+
+  GraphReduction Reduce(Node*) { return GraphReduction(); }
+
+  static void appendName(std::string&) {}
+  void ReportStats() const {}
+};
+template<class ReducerT, class... RestTs>
+struct ReducerChain<ReducerT, RestTs...> {
+  static constexpr bool IsFunctionLocal
+    = IsFunctionLocalReducer<ReducerT>::value &&
+      ReducerChain<RestTs...>::IsFunctionLocal;
+
+  explicit ReducerChain(GraphEditor::Interface* Editor)
+    : Head(Editor), Rest(Editor), NumReductions(0U) {}
+
+  GraphReduction Reduce(Node* N) {
+    auto RP = Head.Reducer.Reduce(N);
+    if(RP.Changed()) {
+      ++NumReductions;
+      if(RP.Replacement() != N) return RP;
+    }
+    auto RestRP = Rest.Reduce(N);
+    return RestRP.Changed()? RestRP : RP;
+  }
+
+  // names of all reducers joined by '+'
+  static void appendName(std::string& Name) {
+    if(!Name.empty()) Name += "+";
+    Name += ReducerT::name();
+    ReducerChain<RestTs...>::appendName(Name);
+  }
+
+  void ReportStats() const {
+    Statistics::Get().AddCounter(ReducerT::name(), "reductions",
+                                 NumReductions);
+    Rest.ReportStats();
+  }
+
+private:
+  ReducerHolder<ReducerT> Head;
+  ReducerChain<RestTs...> Rest;
+  size_t NumReductions;
+};
+
+template<class ReducerT>
+void ReportReducerStats(const ReducerT&) {}
+template<class... ReducerTs>
+void ReportReducerStats(const ReducerChain<ReducerTs...>& Chain) {
+  Chain.ReportStats();
+}
+} // end namespace _detail
+
 /// The primary graph reduction algorithm implement
 class GraphReducer : public GraphEditor::Interface {
   enum class ReductionState : uint8_t {
@@ -98,7 +174,8 @@ class GraphReducer : public GraphEditor::Interface {
   Graph& G;
   Node* DeadNode;
 
-  // visiting stacks
+  // visiting stacks, top of the stack is at the back.
+  // RSMarker guarantees that a node is not pushed twice
   std::vector<Node*> ReductionStack, RevisitStack;
 
   // visiting marker
@@ -106,6 +183,9 @@ class GraphReducer : public GraphEditor::Interface {
 
   bool DoTrimGraph;
 
+  // statistics
+  size_t NumReductions, NumRevisits, NumKilled, NumTrimmed;
+
   GraphReducer(Graph& graph, bool TrimGraph = true);
 
   // implement GraphEditor::Interface
@@ -120,27 +200,176 @@ class GraphReducer : public GraphEditor::Interface {
 
   void DFSVisit(SubGraph& SG, NodeMarker<ReductionState>& Marker);
 
-  void runImpl(_detail::ReducerConcept* R);
-  void runOnFunctionGraph(SubGraph& SG, _detail::ReducerConcept* R);
+  // handle the reduction result of the node on top of the stack
+  void ApplyReduction(Node* N, const GraphReduction& RP);
+  // move nodes waiting for revisit back to ReductionStack
+  void FlushRevisitStack();
+  // remove nodes that are unreachable from any function
+  void TrimGraph();
+
+  std::string getFunctionName(const SubGraph& SG) const;
+  void ReportStats(const char* Name, size_t NumCreated) const;
+
+  // the reducer is a template parameter so that
+  // Reduce calls can be inlined
+  template<class ReducerT>
+  void runOnFunctionGraph(SubGraph& SG, ReducerT& Reducer) {
+    DFSVisit(SG, RSMarker);
+
+    while(!ReductionStack.empty() || !RevisitStack.empty()) {
+      while(!ReductionStack.empty()) {
+        Node* N = ReductionStack.back();
+        if(N->getOp() == IrOpcode::Dead || N->IsDead()) {
+          Pop();
+          continue;
+        }
+        ApplyReduction(N, Reducer.Reduce(N));
+      }
+      FlushRevisitStack();
+    }
+    SG.InvalidateNodes();
+  }
+
+  // reduce each function on one of the NumWorkers threads. Every
+  // thread has its own GraphReducer and reducer, so shared nodes
+  // need to be detached first
+  template<class ReducerT, class FactoryT>
+  void runConcurrently(FactoryT& MakeReducer, size_t NumWorkers) {
+    // NodeMarkers can't be created while building concurrently
+    std::vector<std::unique_ptr<GraphReducer>> Workers;
+    std::vector<std::unique_ptr<ReducerT>> Reducers;
+    for(size_t i = 0U; i < NumWorkers; ++i) {
+      Workers.emplace_back(new GraphReducer(G, false));
+      Reducers.emplace_back(MakeReducer(*Workers.back()));
+    }
+    std::vector<SubGraph*> Functions;
+    for(auto& SG : G.subregions())
+      Functions.push_back(&SG);
+
+    std::atomic<size_t> NextFunction(0U);
+    auto Work = [&,this](size_t WorkerIdx) {
+      auto& Worker = *Workers[WorkerIdx];
+      auto& Reducer = *Reducers[WorkerIdx];
+      for(size_t Idx; (Idx = NextFunction++) < Functions.size();) {
+        Graph::BuildScope Scope(G, Idx, WorkerIdx);
+        Worker.runOnFunctionGraph(*Functions[Idx], Reducer);
+      }
+    };
+    G.BeginConcurrentBuild(Functions.size(), NumWorkers);
+    std::vector<std::thread> Threads;
+    for(size_t i = 1U; i < NumWorkers; ++i)
+      Threads.emplace_back(Work, i);
+    Work(0U);
+    for(auto& T : Threads)
+      T.join();
+    G.EndConcurrentBuild();
+
+    for(size_t i = 0U; i < NumWorkers; ++i) {
+      NumReductions += Workers[i]->NumReductions;
+      NumRevisits += Workers[i]->NumRevisits;
+      NumKilled += Workers[i]->NumKilled;
+      _detail::ReportReducerStats(*Reducers[i]);
+    }
+  }
+
+  // MakeReducer(GraphReducer&) creates the reducer working with
+  // the given GraphReducer. Functions are reduced concurrently if the
+  // reducer is function-local and more than one job is requested,
+  // the result is identical to reducing them one after another except
+  // the order of users of shared nodes.
+  // Return the number of reductions
+  template<class ReducerT, class FactoryT>
+  size_t runImpl(const char* Name, FactoryT MakeReducer) {
+    auto NumNodeIds = G.getNumNodeIds();
+    {
+      PassTimer Timer(Name);
+      std::unique_ptr<ReducerT> Reducer = MakeReducer(*this);
+      bool IsFunctionLocal = _detail::IsFunctionLocalReducer<ReducerT>::value;
+      if(IsFunctionLocal) {
+        // nodes that don't belong to a single function (e.g. sizes
+        // of global variables) are reduced beforehand
+        for(auto* N : G.getCrossFunctionRoots()) {
+          if(N->IsDead()) continue;
+          SubGraph SG(N);
+          runOnFunctionGraph(SG, *Reducer);
+        }
+      }
+      // value numbering should behave the same no matter
+      // shared nodes are detached or not
+      G.SetFunctionLocal(IsFunctionLocal);
+      // only detach shared nodes when there are more than one job,
+      // since it costs a graph-wide scan and re-links their users
+      // in the order of user id
+      bool Detached = IsFunctionLocal && GetNumJobs() > 1U &&
+                      G.subregion_size() > 1U && G.DetachSharedNodes();
+      size_t NumWorkers
+        = Detached? std::min(GetNumJobs(), G.subregion_size()) : 1U;
+      if(NumWorkers > 1U) {
+        runConcurrently<ReducerT>(MakeReducer, NumWorkers);
+      } else {
+        bool TimeFunctions = Statistics::Get().IsTimerEnabled();
+        for(auto& SG : G.subregions()) {
+          if(TimeFunctions) {
+            PassTimer FuncTimer(Name, getFunctionName(SG));
+            runOnFunctionGraph(SG, *Reducer);
+          } else {
+            runOnFunctionGraph(SG, *Reducer);
+          }
+        }
+      }
+      _detail::ReportReducerStats(*Reducer);
+      if(Detached) G.AttachSharedNodes();
+      G.SetFunctionLocal(false);
+
+      if(DoTrimGraph) TrimGraph();
+    }
+    ReportStats(Name, G.getNumNodeIds() - NumNodeIds);
+    return NumReductions;
+  }
 
 public:
+  /// Maximum number of threads used to reduce functions
+  /// concurrently. Default to 1
+  static void SetNumJobs(size_t NumJobs);
+  static size_t GetNumJobs();
+
+  // All the Run functions return the number of reductions.
+  // Each thread constructs a reducer with the same CtorArgs
   template<class ReducerT, class... Args>
-  static void Run(Graph& G, Args &&... CtorArgs) {
+  static size_t Run(Graph& G, Args &&... CtorArgs) {
     GraphReducer GR(G);
-    _detail::ReducerModel<ReducerT, Args...> RM(
-      std::forward<Args>(CtorArgs)...
-    );
-    GR.runImpl(&RM);
+    return GR.runImpl<ReducerT>(ReducerT::name(),
+                                [&](GraphReducer&) {
+                                  return gross::make_unique<ReducerT>(
+                                           CtorArgs...);
+                                });
   }
 
   template<class ReducerT, class... Args>
-  static void RunWithEditor(Graph& G, Args &&...CtorArgs) {
+  static size_t RunWithEditor(Graph& G, Args &&...CtorArgs) {
+    GraphReducer GR(G);
+    // first argument must be GraphEditor::Interface*
+    return GR.runImpl<ReducerT>(ReducerT::name(),
+                                [&](GraphReducer& Editor) {
+                                  return gross::make_unique<ReducerT>(
+                                           &Editor, CtorArgs...);
+                                });
+  }
+
+  /// Run several reducers in a single traversal until all of them
+  /// reach a fixed point. Reducers that are GraphEditor will be
+  /// constructed with the GraphEditor::Interface, others will be
+  /// default constructed.
+  template<class Reducer1T, class Reducer2T, class... ReducerTs>
+  static size_t Run(Graph& G) {
     GraphReducer GR(G);
-    _detail::ReducerModel<ReducerT, GraphEditor::Interface*, Args...> RM(
-      &GR, // first argument must be GraphEditor::Interface*
-      std::forward<Args>(CtorArgs)...
-    );
-    GR.runImpl(&RM);
+    using ChainTy = _detail::ReducerChain<Reducer1T, Reducer2T, ReducerTs...>;
+    std::string Name;
+    ChainTy::appendName(Name);
+    return GR.runImpl<ChainTy>(Name.c_str(),
+                               [](GraphReducer& Editor) {
+                                 return gross::make_unique<ChainTy>(&Editor);
+                               });
   }
 };
 } // end namespace gross
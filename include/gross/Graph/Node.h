@@ -2,9 +2,12 @@
 #define GROSS_GRAPH_NODE_H
 #include "gross/Graph/Opcodes.h"
 #include "gross/Support/Log.h"
+#include "gross/Support/SmallVector.h"
 #include "gross/Support/iterator_range.h"
 #include "boost/container_hash/hash.hpp"
-#include "boost/iterator/filter_iterator.hpp"
+#include "boost/iterator/iterator_facade.hpp"
+#include "boost/iterator/transform_iterator.hpp"
+#include <array>
 #include <functional>
 #include <unordered_map>
 #include <vector>
@@ -13,6 +16,7 @@
 namespace gross {
 // Forward declarations
 class Node;
+class Graph;
 namespace _details {
 template<IrOpcode::ID OC,class SubT>
 struct BinOpNodeBuilder;
@@ -52,32 +56,40 @@ struct Use {
   }
 
   struct BuilderFunctor;
+  template<class PatcherT>
+  struct PatchedBuilderFunctor;
 };
 
 struct Use::BuilderFunctor {
   Node* From;
   Use::Kind DepKind;
 
-  using PatcherTy = std::function<Use(const Use&)>;
-  PatcherTy PatchFunctor;
-
   // will have problem if one just
   // delcare edge iterator without initialize
   // BuilderFunctor() = delete;
   BuilderFunctor() = default;
 
   explicit
-  BuilderFunctor(Node* F, Use::Kind K = K_NONE,
-                 PatcherTy Patcher = nullptr)
-    : From(F), DepKind(K),
-      PatchFunctor(Patcher) {}
+  BuilderFunctor(Node* F, Use::Kind K = K_NONE)
+    : From(F), DepKind(K) {}
+
+  Use operator()(Node* To) const {
+    return Use(From, To, DepKind);
+  }
+};
+
+/// BuilderFunctor that rewrites every edge it builds with PatcherT,
+/// a stateless function object with signature Use(const Use&)
+template<class PatcherT>
+struct Use::PatchedBuilderFunctor : public Use::BuilderFunctor {
+  PatchedBuilderFunctor() = default;
+
+  explicit
+  PatchedBuilderFunctor(Node* F, Use::Kind K = K_NONE)
+    : BuilderFunctor(F, K) {}
 
   Use operator()(Node* To) const {
-    Use E(From, To, DepKind);
-    if(PatchFunctor)
-      return PatchFunctor(E);
-    else
-      return std::move(E);
+    return PatcherT()(BuilderFunctor::operator()(To));
   }
 };
 
@@ -97,14 +109,19 @@ class Node {
 
   IrOpcode::ID Op;
 
-  // used by NodeMarker
-  uint32_t MarkerData;
+  // used by NodeMarker, one word per marker slot
+  static constexpr unsigned NumMarkerSlots = 4;
+  std::array<uint32_t, NumMarkerSlots> MarkerData;
+
+  // dense id assigned by Graph::InsertNode
+  uint32_t Id;
 
   unsigned NumValueInput;
   unsigned NumControlInput;
   unsigned NumEffectInput;
 
-  std::vector<Node*> Inputs;
+  // layout: [value inputs][control inputs][effect inputs]
+  SmallVector<Node*, 3> Inputs;
   inline Use::Kind inputUseKind(unsigned rawInputIdx) {
     assert(rawInputIdx < Inputs.size());
     if(rawInputIdx < NumValueInput) return Use::K_VALUE;
@@ -115,7 +132,36 @@ class Node {
     return Use::K_NONE;
   }
 
-  std::vector<Node*> Users;
+  // Every input edge has a back edge record in the users list
+  // (of the edge's kind) of the input node, which knows the (raw)
+  // input index of the edge. And InputUseIdx[i] is the position of
+  // Inputs[i]'s back edge record, so an edge can be unlinked in
+  // constant time.
+  struct UserEdge {
+    Node* User;
+    uint32_t InputIdx;
+  };
+  using UserListTy = SmallVector<UserEdge, 1>;
+  // indexed by Use::Kind - 1
+  std::array<UserListTy, 3> Users;
+  UserListTy& getUsers(Use::Kind K) {
+    assert(K != Use::K_NONE);
+    return Users[K - 1];
+  }
+  const UserListTy& getUsers(Use::Kind K) const {
+    assert(K != Use::K_NONE);
+    return Users[K - 1];
+  }
+  SmallVector<uint32_t, 3> InputUseIdx;
+  // InputUseIdx of an edge pointing to a shared node
+  // whose user lists are detached
+  static constexpr uint32_t DetachedUseIdx = ~0U;
+
+  void linkInputUse(unsigned RawIdx);
+  void unlinkInputUse(unsigned RawIdx);
+  // update back edge records of inputs starting from RawIdx
+  void reindexInputUses(unsigned RawIdx);
+  void setRawInput(unsigned RawIdx, Node* NewNode);
 
   void setNodeInput(unsigned Index, unsigned Size, unsigned Offset,
                     Node* NewNode);
@@ -123,15 +169,25 @@ class Node {
                        Node* NewNode);
   void removeNodeInput(unsigned Index, unsigned& Size, unsigned Offset);
   void removeNodeInputAll(Node* N, unsigned& Size, unsigned Offset);
-  void cleanupRemoveNodeInput(Node* OldInput);
+  // remove all inputs that satisfy Pred in a single pass
+  template<class UnaryPred>
+  void removeInputsIf(UnaryPred Pred);
 
   bool IsKilled;
+  // used by more than one function, see Graph::DetachSharedNodes
+  bool IsSharedNode;
 
 public:
   using MarkerTy = uint32_t;
 
   IrOpcode::ID getOp() const { return Op; }
 
+  bool hasId() const { return Id != ~0U; }
+  uint32_t getId() const {
+    assert(hasId() && "Node not inserted into Graph yet");
+    return Id;
+  }
+
   inline
   unsigned getNumValueInput() const { return NumValueInput; }
   inline
@@ -174,6 +230,7 @@ public:
   // (remaining) users with Dead Node
   void Kill(Node* DeadNode);
   bool IsDead() const { return IsKilled; }
+  bool IsShared() const { return IsSharedNode; }
 
   using input_iterator = typename decltype(Inputs)::iterator;
   using const_input_iterator = typename decltype(Inputs)::const_iterator;
@@ -214,86 +271,146 @@ public:
   input_iterator effect_input_begin() { return effect_inputs().begin(); }
   input_iterator effect_input_end() { return effect_inputs().end(); }
 
-  struct is_value_use {
-    Node* SrcNode;
-    is_value_use(Node* Src) : SrcNode(Src) {}
-
-    bool operator()(Node* Sink) {
-      for(Node* Dep : Sink->value_inputs()) {
-        if(Dep == SrcNode) return true;
+  struct get_user {
+    Node* operator()(const UserEdge& E) const { return E.User; }
+  };
+  // users of a single dependency kind
+  using kind_user_iterator
+    = boost::transform_iterator<get_user,
+                                typename UserListTy::iterator,
+                                Node*, // Reference type
+                                Node* // Value type
+                                >;
+  using value_user_iterator = kind_user_iterator;
+  using control_user_iterator = kind_user_iterator;
+  using effect_user_iterator = kind_user_iterator;
+
+  // users of all kinds, in the order of value, control
+  // and effect users
+  class user_iterator
+    : public boost::iterator_facade<user_iterator, Node*,
+                                    boost::forward_traversal_tag,
+                                    Node* // Reference type
+                                    > {
+    friend class boost::iterator_core_access;
+
+    const Node* Src;
+    unsigned KindIdx, Idx;
+
+    void skipEmpty() {
+      while(KindIdx < Src->Users.size() &&
+            Idx >= Src->Users[KindIdx].size()) {
+        ++KindIdx;
+        Idx = 0;
       }
-      return false;
     }
-  };
-  struct is_control_use {
-    Node* SrcNode;
-    is_control_use(Node* Src) : SrcNode(Src) {}
 
-    bool operator()(Node* Sink) {
-      for(Node* Dep : Sink->control_inputs()) {
-        if(Dep == SrcNode) return true;
-      }
-      return false;
+    void increment() {
+      ++Idx;
+      skipEmpty();
     }
-  };
-  struct is_effect_use {
-    Node* SrcNode;
-    is_effect_use(Node* Src) : SrcNode(Src) {}
+    bool equal(const user_iterator& Other) const {
+      return Src == Other.Src &&
+             KindIdx == Other.KindIdx &&
+             Idx == Other.Idx;
+    }
+    Node* dereference() const { return Src->Users[KindIdx][Idx].User; }
 
-    bool operator()(Node* Sink) {
-      for(Node* Dep : Sink->effect_inputs()) {
-        if(Dep == SrcNode) return true;
-      }
-      return false;
+  public:
+    user_iterator() : Src(nullptr), KindIdx(0), Idx(0) {}
+    user_iterator(const Node* N, bool IsEnd = false)
+      : Src(N), KindIdx(IsEnd? N->Users.size() : 0), Idx(0) {
+      skipEmpty();
     }
   };
-  using user_iterator = typename decltype(Users)::iterator;
-  using value_user_iterator
-    = boost::filter_iterator<is_value_use, user_iterator>;
-  using control_user_iterator
-    = boost::filter_iterator<is_control_use, user_iterator>;
-  using effect_user_iterator
-    = boost::filter_iterator<is_effect_use, user_iterator>;
 
   llvm::iterator_range<user_iterator>
   users() {
-    return llvm::make_range(Users.begin(), Users.end());
+    return llvm::make_range(user_iterator(this),
+                            user_iterator(this, true));
+  }
+  llvm::iterator_range<kind_user_iterator>
+  users(Use::Kind K) {
+    auto& L = getUsers(K);
+    return llvm::make_range(kind_user_iterator(L.begin()),
+                            kind_user_iterator(L.end()));
   }
   llvm::iterator_range<value_user_iterator>
-  value_users();
+  value_users() { return users(Use::K_VALUE); }
   llvm::iterator_range<control_user_iterator>
-  control_users();
+  control_users() { return users(Use::K_CONTROL); }
   llvm::iterator_range<effect_user_iterator>
-  effect_users();
+  effect_users() { return users(Use::K_EFFECT); }
 
-  size_t user_size() const { return Users.size(); }
+  size_t user_size() const {
+    return Users[0].size() + Users[1].size() + Users[2].size();
+  }
+  size_t user_size(Use::Kind K) const { return getUsers(K).size(); }
 
   Node()
     : Op(IrOpcode::None),
-      MarkerData(0U),
+      MarkerData(),
+      Id(~0U),
       NumValueInput(0),
       NumControlInput(0),
       NumEffectInput(0),
-      IsKilled(false) {}
+      IsKilled(false),
+      IsSharedNode(false) {}
 
   Node(IrOpcode::ID OC)
     : Op(OC),
-      MarkerData(0U),
+      MarkerData(),
+      Id(~0U),
       NumValueInput(0),
       NumControlInput(0),
       NumEffectInput(0),
-      IsKilled(false) {}
+      IsKilled(false),
+      IsSharedNode(false) {}
 
   Node(IrOpcode::ID OC,
        const std::vector<Node*>& Values,
        const std::vector<Node*>& Controls = {},
        const std::vector<Node*>& Effects = {});
 
+  // nodes are always allocated from (and owned by) the
+  // node arena of a Graph. e.g. new (G) Node(...)
+  static void* operator new(size_t Size, Graph& G);
+  static void operator delete(void* Ptr, Graph& G);
+  static void* operator new(size_t Size) = delete;
+
   bool ReplaceUseOfWith(Node* From, Node* To, Use::Kind UseKind);
   // replace this node with Replacement in all its users
   void ReplaceWith(Node* Replacement, Use::Kind UseKind = Use::K_NONE);
 };
 
+template<class UnaryPred>
+void Node::removeInputsIf(UnaryPred Pred) {
+  // unlink first: unlinkInputUse might update the
+  // record index of other inputs in this node
+  unsigned NumRemoved[3] = {0U, 0U, 0U};
+  for(unsigned i = 0U, N = Inputs.size(); i < N; ++i) {
+    if(!Pred(Inputs[i])) continue;
+    unlinkInputUse(i);
+    ++NumRemoved[inputUseKind(i) - 1];
+  }
+  if(!(NumRemoved[0] + NumRemoved[1] + NumRemoved[2])) return;
+
+  // then compact
+  unsigned NewSize = 0U;
+  for(unsigned i = 0U, N = Inputs.size(); i < N; ++i) {
+    if(Pred(Inputs[i])) continue;
+    Inputs[NewSize] = Inputs[i];
+    InputUseIdx[NewSize] = InputUseIdx[i];
+    ++NewSize;
+  }
+  Inputs.resize(NewSize);
+  InputUseIdx.resize(NewSize);
+  NumValueInput -= NumRemoved[Use::K_VALUE - 1];
+  NumControlInput -= NumRemoved[Use::K_CONTROL - 1];
+  NumEffectInput -= NumRemoved[Use::K_EFFECT - 1];
+  reindexInputUses(0U);
+}
+
 template<typename ValueT>
 class NodeBiMap {
   std::unordered_map<Node*, ValueT> Node2Value;
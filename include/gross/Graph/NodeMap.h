@@ -0,0 +1,171 @@
+#ifndef GROSS_GRAPH_NODEMAP_H
+#define GROSS_GRAPH_NODEMAP_H
+#include "boost/iterator/filter_iterator.hpp"
+#include "gross/Graph/Node.h"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace gross {
+/// Map from Node to T using node's dense id as index.
+/// Iterating a NodeMap visits entries in the order of node id,
+/// which is also the order nodes are inserted into Graph
+template<class T>
+class NodeMap {
+public:
+  using key_type = Node*;
+  using mapped_type = T;
+  using value_type = std::pair<Node*, T>;
+
+private:
+  // slot is empty if the key is nullptr
+  std::vector<value_type> Entries;
+  size_t NumEntries;
+
+  struct is_occupied {
+    bool operator()(const value_type& E) const { return E.first; }
+  };
+
+  value_type* getEntry(const Node* N) {
+    auto Id = N->getId();
+    if(Id >= Entries.size() || !Entries[Id].first)
+      return nullptr;
+    return &Entries[Id];
+  }
+  const value_type* getEntry(const Node* N) const {
+    return const_cast<NodeMap*>(this)->getEntry(N);
+  }
+
+public:
+  using iterator
+    = boost::filter_iterator<is_occupied,
+                             typename std::vector<value_type>::iterator>;
+  using const_iterator
+    = boost::filter_iterator<is_occupied,
+                             typename std::vector<value_type>::const_iterator>;
+
+  NodeMap() : NumEntries(0) {}
+  explicit NodeMap(size_t NumNodeIds) : NumEntries(0) {
+    Entries.reserve(NumNodeIds);
+  }
+
+  iterator begin() {
+    return iterator(is_occupied(), Entries.begin(), Entries.end());
+  }
+  iterator end() {
+    return iterator(is_occupied(), Entries.end(), Entries.end());
+  }
+  const_iterator begin() const {
+    return const_iterator(is_occupied(), Entries.cbegin(), Entries.cend());
+  }
+  const_iterator end() const {
+    return const_iterator(is_occupied(), Entries.cend(), Entries.cend());
+  }
+
+  size_t size() const { return NumEntries; }
+  bool empty() const { return NumEntries == 0; }
+
+  size_t count(const Node* N) const { return getEntry(N)? 1 : 0; }
+
+  iterator find(const Node* N) {
+    if(!getEntry(N)) return end();
+    return iterator(is_occupied(),
+                    Entries.begin() + N->getId(), Entries.end());
+  }
+
+  T& at(const Node* N) {
+    auto* E = getEntry(N);
+    assert(E && "Node not found");
+    return E->second;
+  }
+  const T& at(const Node* N) const {
+    auto* E = getEntry(N);
+    assert(E && "Node not found");
+    return E->second;
+  }
+
+  T& operator[](const Node* N) {
+    auto Id = N->getId();
+    if(Id >= Entries.size())
+      Entries.resize(Id + 1);
+    auto& E = Entries[Id];
+    if(!E.first) {
+      E.first = const_cast<Node*>(N);
+      ++NumEntries;
+    }
+    return E.second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& V) {
+    bool Inserted = !count(V.first);
+    if(Inserted)
+      (*this)[V.first] = V.second;
+    return std::make_pair(find(V.first), Inserted);
+  }
+  std::pair<iterator, bool> insert(value_type&& V) {
+    bool Inserted = !count(V.first);
+    if(Inserted)
+      (*this)[V.first] = std::move(V.second);
+    return std::make_pair(find(V.first), Inserted);
+  }
+
+  size_t erase(const Node* N) {
+    auto* E = getEntry(N);
+    if(!E) return 0;
+    E->first = nullptr;
+    E->second = T();
+    --NumEntries;
+    return 1;
+  }
+
+  void clear() {
+    Entries.clear();
+    NumEntries = 0;
+  }
+};
+
+/// Set of Nodes implemented by bit vector indexing
+/// with node's dense id
+class NodeSet {
+  std::vector<bool> Bits;
+  size_t NumNodes;
+
+public:
+  NodeSet() : NumNodes(0) {}
+  explicit NodeSet(size_t NumNodeIds)
+    : Bits(NumNodeIds, false), NumNodes(0) {}
+
+  size_t size() const { return NumNodes; }
+  bool empty() const { return NumNodes == 0; }
+
+  size_t count(const Node* N) const {
+    auto Id = N->getId();
+    return Id < Bits.size() && Bits[Id]? 1 : 0;
+  }
+
+  // return true if N is newly inserted
+  bool insert(const Node* N) {
+    auto Id = N->getId();
+    if(Id >= Bits.size())
+      Bits.resize(std::max<size_t>(Id + 1, Bits.size() * 2), false);
+    if(Bits[Id]) return false;
+    Bits[Id] = true;
+    ++NumNodes;
+    return true;
+  }
+
+  size_t erase(const Node* N) {
+    if(!count(N)) return 0;
+    Bits[N->getId()] = false;
+    --NumNodes;
+    return 1;
+  }
+
+  void clear() {
+    Bits.clear();
+    NumNodes = 0;
+  }
+};
+} // end namespace gross
+#endif
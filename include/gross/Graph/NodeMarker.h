@@ -6,22 +6,41 @@ namespace gross {
 // Forward declarations
 class Graph;
 
-/// scratch data inside Node that is fast to access
-/// note that there should be only one kind of NodeMarker
-/// active at a given time
+/// scratch data inside Node that is fast to access.
+/// Each Node has Node::NumMarkerSlots marker words, and every
+/// NodeMarker takes the least occupied slot when created. So (up to
+/// Node::NumMarkerSlots) NodeMarkers can be nested without clobbering
+/// each other. Markers sharing the same slot should work on disjoint
+/// set of nodes, in which case only the newest one can see a node.
 class NodeMarkerBase {
 protected:
   using MarkerTy = typename Node::MarkerTy;
 
 private:
+  Graph* G;
+  unsigned Slot;
+  unsigned NumState;
   MarkerTy MarkerMin, MarkerMax;
 
+  // reserve a new state range in Slot
+  void NewGeneration();
+
 public:
   NodeMarkerBase(Graph& G, unsigned NumState);
+  NodeMarkerBase(const NodeMarkerBase&) = delete;
+  NodeMarkerBase& operator=(const NodeMarkerBase&) = delete;
+  NodeMarkerBase(NodeMarkerBase&& Other);
+
+  ~NodeMarkerBase();
+
+  unsigned getSlot() const { return Slot; }
 
   MarkerTy Get(Node* N);
 
   void Set(Node* N, MarkerTy Val);
+
+  // reset states of all nodes to zero in O(1)
+  void Reset() { NewGeneration(); }
 };
 
 template<class T>
@@ -15,6 +15,7 @@ NODE_PROPERTIES(ConstantInt) {
   template<typename T>
   T as(const Graph& G) const {
     if(!*this) return T();
+    auto Lock = G.LockPools();
     if(auto* V = G.ConstNumberPool.find_value(NodePtr))
       return static_cast<T>(*V);
     else
@@ -27,12 +28,14 @@ NODE_PROPERTIES(ConstantStr) {
 
   const std::string& str(const Graph& G) const {
     assert(*this && "Invalid Node");
+    auto Lock = G.LockPools();
     const auto* V = G.ConstStrPool.find_value(NodePtr);
     assert(V && "string not found");
     return *V;
   }
   const std::string str_val(const Graph& G) const {
     if(!*this) return "";
+    auto Lock = G.LockPools();
     if(const auto* V = G.ConstStrPool.find_value(NodePtr))
       return *V;
     else
@@ -46,10 +49,13 @@ NODE_PROPERTIES(FunctionStub) {
 
   Node* getFunctionStart(const Graph& G) const {
     assert(*this && "Invalid node");
-    auto* SGPtr = G.FuncStubPool.find_value(NodePtr);
-    assert(SGPtr && "subgraph not found");
-    auto& SG = *SGPtr;
-    auto* EndNode = SubGraph::GetNodeFromIt(SG.node_begin());
+    Node* EndNode;
+    {
+      auto Lock = G.LockPools();
+      auto* SGPtr = G.FuncStubPool.find_value(NodePtr);
+      assert(SGPtr && "subgraph not found");
+      EndNode = SGPtr->getTail();
+    }
     auto StartIt = gross::find_if(EndNode->inputs(),
                                   [](Node* N) -> bool {
                                     return N->getOp() == IrOpcode::Start;
@@ -180,6 +186,7 @@ NODE_PROPERTIES(Start) {
   Node* FuncStub(Graph& G) const {
     auto* End = EndNode();
     assert(End);
+    auto Lock = G.LockPools();
     return G.FuncStubPool.find_node(SubGraph(End));
   }
 };
@@ -615,9 +622,12 @@ struct NodeBuilder<IrOpcode::Dead> {
   NodeBuilder(Graph* graph) : G(graph) {}
 
   Node* Build() {
+    auto Lock = G->LockPools();
     if(!G->DeadNode) {
-      G->DeadNode = new Node(IrOpcode::Dead, {});
+      G->DeadNode = new (*G) Node(IrOpcode::Dead, {});
       G->InsertNode(G->DeadNode);
+    } else {
+      G->UsePooledNode(G->DeadNode);
     }
     return G->DeadNode;
   }
@@ -632,11 +642,13 @@ struct NodeBuilder<IrOpcode::ConstantInt> {
     : G(graph), Val(val) {}
 
   Node* Build() {
-    if(auto* N = G->ConstNumberPool.find_node(Val))
+    auto Lock = G->LockPools();
+    if(auto* N = G->ConstNumberPool.find_node(Val)) {
+      G->UsePooledNode(N);
       return N;
-    else {
+    } else {
       // New constant Node
-      Node* NewN = new Node(IrOpcode::ConstantInt);
+      Node* NewN = new (*G) Node(IrOpcode::ConstantInt);
       G->ConstNumberPool.insert({NewN, Val});
       G->InsertNode(NewN);
       return NewN;
@@ -655,11 +667,13 @@ struct NodeBuilder<IrOpcode::ConstantStr> {
       SymName(Name) {}
 
   Node* Build(){
-    if(auto* N = G->ConstStrPool.find_node(SymName))
+    auto Lock = G->LockPools();
+    if(auto* N = G->ConstStrPool.find_node(SymName)) {
+      G->UsePooledNode(N);
       return N;
-    else {
+    } else {
       // New constant Node
-      Node* NewN = new Node(IrOpcode::ConstantStr);
+      Node* NewN = new (*G) Node(IrOpcode::ConstantStr);
       G->ConstStrPool.insert({NewN, SymName});
       G->InsertNode(NewN);
       return NewN;
@@ -682,12 +696,14 @@ struct NodeBuilder<IrOpcode::FunctionStub> {
   //}
 
   Node* Build() {
-    if(auto* N = G->FuncStubPool.find_node(SG))
+    auto Lock = G->LockPools();
+    if(auto* N = G->FuncStubPool.find_node(SG)) {
+      G->UsePooledNode(N);
       return N;
-    else {
+    } else {
       // New function stub node
       // TODO: attribute and node update
-      Node* NewN = new Node(IrOpcode::FunctionStub);
+      Node* NewN = new (*G) Node(IrOpcode::FunctionStub);
       G->FuncStubPool.insert({NewN, SG});
       G->InsertNode(NewN);
       return NewN;
@@ -714,9 +730,7 @@ struct NodeBuilder<IrOpcode::Call> {
 
   Node* Build() {
     Params.insert(Params.begin(), FuncStub);
-    auto* N = new Node(IrOpcode::Call, Params);
-    for(auto* P : Params)
-      P->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::Call, Params);
     G->InsertNode(N);
     return N;
   }
@@ -740,8 +754,7 @@ struct NodeBuilder<IrOpcode::SrcVarDecl> {
   Node* Build() {
     Node* SymNameNode = NodeBuilder<IrOpcode::ConstantStr>(G, SymName).Build();
     // Value dependency
-    Node* VarDeclNode = new Node(IrOpcode::SrcVarDecl, {SymNameNode});
-    SymNameNode->Users.push_back(VarDeclNode);
+    Node* VarDeclNode = new (*G) Node(IrOpcode::SrcVarDecl, {SymNameNode});
     G->InsertNode(VarDeclNode);
     return VarDeclNode;
   }
@@ -783,9 +796,7 @@ struct NodeBuilder<IrOpcode::SrcArrayDecl> {
     // 1..N: dimension expression
     std::vector<Node*> ValDeps{SymNode};
     ValDeps.insert(ValDeps.end(), Dims.begin(), Dims.end());
-    Node* ArrDeclNode = new Node(IrOpcode::SrcArrayDecl, ValDeps);
-    for(auto* N : ValDeps)
-      N->Users.push_back(ArrDeclNode);
+    Node* ArrDeclNode = new (*G) Node(IrOpcode::SrcArrayDecl, ValDeps);
     G->InsertNode(ArrDeclNode);
     return ArrDeclNode;
   }
@@ -803,9 +814,8 @@ struct NodeBuilder<IrOpcode::SrcInitialArray> {
       ArrayDecl(Decl) {}
 
   Node* Build() {
-    auto* N = new Node(IrOpcode::SrcInitialArray,
-                       {ArrayDecl});
-    ArrayDecl->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::SrcInitialArray,
+                            {ArrayDecl});
     G->InsertNode(N);
     return N;
   }
@@ -832,10 +842,11 @@ struct BinOpNodeBuilder {
   }
 
   Node* Build() {
-    auto* BinOp = new Node(OC, {LHSNode, RHSNode});
-    LHSNode->Users.push_back(BinOp);
-    RHSNode->Users.push_back(BinOp);
+    if(auto* N = G->FindValueNumber(OC, LHSNode, RHSNode))
+      return N;
+    auto* BinOp = new (*G) Node(OC, {LHSNode, RHSNode});
     G->InsertNode(BinOp);
+    G->AddValueNumber(BinOp);
     return BinOp;
   }
 
@@ -891,12 +902,10 @@ struct NodeBuilder<IrOpcode::SrcVarAccess> {
 
     std::vector<Node*> Effects;
     if(EffectDep) Effects.push_back(EffectDep);
-    auto* N = new Node(IrOpcode::SrcVarAccess,
-                       {VarDecl},// value inputs
-                       {}/*control inputs*/,
-                       Effects/*effect inputs*/);
-    VarDecl->Users.push_back(N);
-    if(EffectDep) EffectDep->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::SrcVarAccess,
+                            {VarDecl},// value inputs
+                            {}/*control inputs*/,
+                            Effects/*effect inputs*/);
     G->InsertNode(N);
     return N;
   }
@@ -946,13 +955,10 @@ struct NodeBuilder<IrOpcode::SrcArrayAccess> {
     ValDeps.insert(ValDeps.end(), Dims.begin(), Dims.end());
     std::vector<Node*> EffectDeps;
     if(EffectDep) EffectDeps.push_back(EffectDep);
-    Node* ArrAccessNode = new Node(IrOpcode::SrcArrayAccess,
-                                   ValDeps, // value dependencies
-                                   {}, // control dependencies
-                                   EffectDeps); // effect dependencies
-    for(auto* N : ValDeps)
-      N->Users.push_back(ArrAccessNode);
-    if(EffectDep) EffectDep->Users.push_back(ArrAccessNode);
+    Node* ArrAccessNode = new (*G) Node(IrOpcode::SrcArrayAccess,
+                                        ValDeps, // value dependencies
+                                        {}, // control dependencies
+                                        EffectDeps); // effect dependencies
     G->InsertNode(ArrAccessNode);
     return ArrAccessNode;
   }
@@ -977,10 +983,8 @@ struct NodeBuilder<IrOpcode::SrcAssignStmt> {
   }
 
   Node* Build() {
-    auto* N = new Node(IrOpcode::SrcAssignStmt,
-                       {DestNode, SrcNode});
-    DestNode->Users.push_back(N);
-    SrcNode->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::SrcAssignStmt,
+                            {DestNode, SrcNode});
     G->InsertNode(N);
     return N;
   }
@@ -1003,9 +1007,8 @@ struct NodeBuilder<IrOpcode::VirtIfBranches> {
 
   Node* Build() {
     assert(IfNode && "If node cannot be null");
-    auto* N = new Node(BranchKind? IrOpcode::IfTrue : IrOpcode::IfFalse,
-                       {}, {IfNode});
-    IfNode->Users.push_back(N);
+    auto* N = new (*G) Node(BranchKind? IrOpcode::IfTrue : IrOpcode::IfFalse,
+                            {}, {IfNode});
     G->InsertNode(N);
     return N;
   }
@@ -1029,9 +1032,8 @@ struct NodeBuilder<IrOpcode::If> {
 
   Node* Build() {
     assert(Predicate && "condition can not be null");
-    auto* N = new Node(IrOpcode::If,
-                       {Predicate});
-    Predicate->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::If,
+                            {Predicate});
     G->InsertNode(N);
     return N;
   }
@@ -1050,10 +1052,8 @@ struct NodeBuilder<IrOpcode::Merge> {
   }
 
   Node* Build() {
-    auto* N = new Node(IrOpcode::Merge,
-                       {}, Ctrls);
-    for(auto* Ctrl : Ctrls)
-      Ctrl->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::Merge,
+                            {}, Ctrls);
     G->InsertNode(N);
     return N;
   }
@@ -1073,10 +1073,8 @@ struct NodeBuilder<IrOpcode::EffectMerge> {
   }
 
   Node* Build() {
-    auto* N = new Node(IrOpcode::EffectMerge,
-                       {}, {}, Effects);
-    for(auto* Effect : Effects)
-      Effect->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::EffectMerge,
+                            {}, {}, Effects);
     G->InsertNode(N);
     return N;
   }
@@ -1107,14 +1105,9 @@ struct NodeBuilder<IrOpcode::Phi> {
 
   Node* Build() {
     assert(MergeNode && "PHI require control merge point");
-    auto* N = new Node(IrOpcode::Phi,
-                       ValueDeps, {MergeNode},
-                       EffectDeps);
-    MergeNode->Users.push_back(N);
-    for(auto* VD : ValueDeps)
-      VD->Users.push_back(N);
-    for(auto* ED : EffectDeps)
-      ED->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::Phi,
+                            ValueDeps, {MergeNode},
+                            EffectDeps);
     G->InsertNode(N);
     return N;
   }
@@ -1134,8 +1127,7 @@ struct NodeBuilder<IrOpcode::Argument> {
   Node* Build() {
     auto* NameStrNode = NodeBuilder<IrOpcode::ConstantStr>(G, SrcArgName)
                         .Build();
-    auto* N = new Node(IrOpcode::Argument, {NameStrNode});
-    NameStrNode->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::Argument, {NameStrNode});
     G->InsertNode(N);
     return N;
   }
@@ -1174,12 +1166,9 @@ struct NodeBuilder<IrOpcode::VirtFuncPrototype> {
     }
 
     // Start node has effect dependency on arguments
-    auto* StartNode = new Node(IrOpcode::Start,
-                               {NameStrNode},
-                               {}, Parameters);
-    NameStrNode->Users.push_back(StartNode);
-    for(auto* PN : Parameters)
-      PN->Users.push_back(StartNode);
+    auto* StartNode = new (*G) Node(IrOpcode::Start,
+                                    {NameStrNode},
+                                    {}, Parameters);
     G->InsertNode(StartNode);
     return StartNode;
   }
@@ -1211,12 +1200,8 @@ struct NodeBuilder<IrOpcode::End> {
     if(!TermNodes.empty())
       CtrlDeps = std::move(TermNodes);
     CtrlDeps.insert(CtrlDeps.begin(), StartNode);
-    auto* N = new Node(IrOpcode::End,
-                       {}, CtrlDeps, EffectDeps);
-    for(auto* TN : CtrlDeps)
-      TN->Users.push_back(N);
-    for(auto* E : EffectDeps)
-      E->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::End,
+                            {}, CtrlDeps, EffectDeps);
     G->InsertNode(N);
     return N;
   }
@@ -1236,10 +1221,9 @@ struct NodeBuilder<IrOpcode::Return> {
   Node* Build() {
     Node* N = nullptr;
     if(ReturnExpr) {
-      N = new Node(IrOpcode::Return, {ReturnExpr});
-      ReturnExpr->Users.push_back(N);
+      N = new (*G) Node(IrOpcode::Return, {ReturnExpr});
     } else {
-      N = new Node(IrOpcode::Return, {});
+      N = new (*G) Node(IrOpcode::Return, {});
     }
     G->InsertNode(N);
     return N;
@@ -1271,12 +1255,10 @@ struct NodeBuilder<IrOpcode::Loop> {
     auto* IfFalse = NodeBuilder<IrOpcode::VirtIfBranches>(G, false)
                     .IfStmt(IfNode)
                     .Build();
-    auto* LoopNode = new Node(IrOpcode::Loop, {},
-                              // backedge is always behind LastCtrlPoint!
-                              {LastCtrlPoint, IfTrue});
+    auto* LoopNode = new (*G) Node(IrOpcode::Loop, {},
+                                   // backedge is always behind LastCtrlPoint!
+                                   {LastCtrlPoint, IfTrue});
     IfNode->appendControlInput(LoopNode);
-    LastCtrlPoint->Users.push_back(LoopNode);
-    IfTrue->Users.push_back(LoopNode);
     G->InsertNode(LoopNode);
     return LoopNode;
   }
@@ -1303,9 +1285,8 @@ struct NodeBuilder<IrOpcode::Alloca> {
       AllocationSize = NodeBuilder<IrOpcode::ConstantInt>(G, 1)
                        .Build();
 
-    auto* N = new Node(IrOpcode::Alloca,
-                       {AllocationSize});
-    AllocationSize->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::Alloca,
+                            {AllocationSize});
     G->InsertNode(N);
     return N;
   }
@@ -1322,10 +1303,8 @@ struct NodeBuilder<IrOpcode::MemLoad>
     : _internal::MemNodeBuilder<IrOpcode::MemLoad>(graph) {}
 
   Node* Build() {
-    auto* N = new Node(IrOpcode::MemLoad,
-                       {BaseAddrNode, OffsetNode});
-    BaseAddrNode->Users.push_back(N);
-    OffsetNode->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::MemLoad,
+                            {BaseAddrNode, OffsetNode});
     G->InsertNode(N);
     return N;
   }
@@ -1342,12 +1321,9 @@ struct NodeBuilder<IrOpcode::MemStore>
   }
 
   Node* Build() {
-    auto* N = new Node(IrOpcode::MemStore,
-                       {BaseAddrNode, OffsetNode,
-                        SrcNode});
-    BaseAddrNode->Users.push_back(N);
-    OffsetNode->Users.push_back(N);
-    SrcNode->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::MemStore,
+                            {BaseAddrNode, OffsetNode,
+                             SrcNode});
     G->InsertNode(N);
     return N;
   }
@@ -1357,5 +1333,14 @@ private:
 };
 
 Node* FindNearestCtrlPoint(Node* N);
+
+// nobody observes the global variables after main returns
+bool IsMainFunction(const Graph& G, const SubGraph& SG);
+
+// connect the effect users of Load to its effect input. If the
+// effect input is left without other effect users, it's appended
+// to End, the end of Load's function, so the modifications before
+// it (e.g. stores to global variables) are still alive
+void RemoveLoadFromEffectChain(Node* Load, Node* End);
 } // end namespace gross
 #endif
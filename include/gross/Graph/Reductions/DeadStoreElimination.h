@@ -0,0 +1,48 @@
+#ifndef GROSS_GRAPH_REDUCTIONS_DEAD_STORE_ELIMINATION_H
+#define GROSS_GRAPH_REDUCTIONS_DEAD_STORE_ELIMINATION_H
+#include "gross/Graph/GraphReducer.h"
+#include "gross/Graph/Node.h"
+#include "gross/Graph/NodeMap.h"
+#include "gross/Graph/Reductions/MemoryAlias.h"
+
+namespace gross {
+/// Remove MemStores that are never observed. That is, walking down
+/// the effect chain, every path either reaches another MemStore to
+/// the same address, or leaves the function where the memory is no
+/// longer visible(local Allocas, or global variables in main),
+/// without passing through any MemLoad that might read the address.
+/// Anything else on the chain(e.g. PHI, EffectMerge, Call) is
+/// considered as an observer.
+/// MemLoads whose values are no longer used are removed from the
+/// effect chain as well.
+class DeadStoreEliminationReducer : public GraphEditor {
+  Graph& G;
+  Node* DeadNode;
+
+  // MemStores in main, whose modifications on global
+  // variables are not observable after it returns
+  NodeSet MainStores;
+  // MemLoad -> End of its function
+  NodeMap<Node*> LoadEnds;
+
+  MemoryAlias MA;
+
+  bool IsUnobservedOnExit(Node* Store) const;
+  bool IsDeadStore(Node* Store) const;
+  // take the MemLoads that are only used by Store out of the
+  // effect chain, since they will be dead along with it
+  void RemoveDeadLoads(Node* Store);
+
+  GraphReduction ReduceMemoryStore(Node* N);
+  GraphReduction ReduceMemoryLoad(Node* N);
+
+public:
+  static constexpr
+  const char* name() { return "dead-store-elimination"; }
+
+  explicit DeadStoreEliminationReducer(GraphEditor::Interface* editor);
+
+  GraphReduction Reduce(Node* N);
+};
+} // end namespace gross
+#endif
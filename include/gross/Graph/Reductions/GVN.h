@@ -0,0 +1,84 @@
+#ifndef GROSS_GRAPH_REDUCTIONS_GVN_H
+#define GROSS_GRAPH_REDUCTIONS_GVN_H
+#include "gross/Graph/GraphReducer.h"
+#include "gross/Graph/Node.h"
+#include "gross/Graph/NodeMap.h"
+#include <unordered_map>
+#include <vector>
+
+namespace gross {
+/// Global value numbering that partitions nodes into congruence
+/// classes optimistically: all the nodes start from 'unknown' and
+/// the value numbers are refined until fixed point, so loop PHIs
+/// whose backedge values turn out to be congruent with their initial
+/// values collapse.
+/// MemLoads are congruent with the value stored by the last MemStore
+/// to the same address, where loads are transparent to the memory
+/// state, as well as EffectMerges and PHIs whose effect inputs are all
+/// in the same state. Otherwise they're only congruent with loads
+/// reading the same effect node.
+/// Partitions are computed upon construction, the reductions
+/// afterward only replace nodes with the leader of their classes.
+class GVNReducer : public GraphEditor {
+  Graph& G;
+
+  struct CongruenceKey {
+    IrOpcode::ID Op;
+    // control merge for PHI, effect input for MemLoad
+    Node* Pin;
+    std::vector<Node*> Operands;
+
+    bool operator==(const CongruenceKey& Other) const {
+      return Op == Other.Op && Pin == Other.Pin &&
+             Operands == Other.Operands;
+    }
+  };
+  struct CongruenceKeyHash {
+    size_t operator()(const CongruenceKey& Key) const;
+  };
+  using congruence_table
+    = std::unordered_map<CongruenceKey, Node*, CongruenceKeyHash>;
+
+  // node -> leader of its congruence class.
+  // nullptr if it's still unknown (i.e. optimistically congruent
+  // with anything)
+  NodeMap<Node*> ValueNumbers;
+  // node -> the memory state observed by its effect users
+  NodeMap<Node*> MemoryStates;
+  // MemLoad -> End of its function
+  NodeMap<Node*> LoadEnds;
+
+  void Analyze(SubGraph& SG);
+
+  Node* getValueNumber(Node* N) const;
+  Node* getMemoryState(Node* N) const;
+
+  // return N if there is no existing leader in Table
+  static Node* LookupOrInsert(congruence_table& Table,
+                              CongruenceKey&& Key, Node* N);
+  // the only known value among Inputs if they are all congruent,
+  // or nullptr
+  static Node* TryMerge(const std::vector<Node*>& Inputs);
+
+  // return false if the content of BaseAddr + Offset in memory State
+  // can not be determined. Otherwise Content is set to its value
+  // number, which might be nullptr if it's still unknown
+  bool FindMemoryContent(Node* State, Node* BaseAddr, Node* Offset,
+                         Node*& Content, std::vector<Node*>& Visiting) const;
+
+  Node* ComputeValueNumber(Node* N, congruence_table& Table);
+  Node* ComputeMemoryState(Node* N, congruence_table& Table);
+
+  GraphReduction ReducePhi(Node* N);
+  GraphReduction ReduceMemoryLoad(Node* N);
+
+public:
+  static constexpr
+  const char* name() { return "gvn"; }
+
+  explicit GVNReducer(GraphEditor::Interface* editor);
+
+  GraphReduction Reduce(Node* N);
+};
+} // end namespace gross
+#endif
@@ -0,0 +1,41 @@
+#ifndef GROSS_GRAPH_REDUCTIONS_LOAD_ELIMINATION_H
+#define GROSS_GRAPH_REDUCTIONS_LOAD_ELIMINATION_H
+#include "gross/Graph/GraphReducer.h"
+#include "gross/Graph/Node.h"
+#include "gross/Graph/NodeMap.h"
+#include "gross/Graph/Reductions/MemoryAlias.h"
+
+namespace gross {
+/// Walk up the effect chain of a MemLoad and
+///  1. Forward the value of a MemStore to the same address.
+///  2. Reuse an earlier MemLoad from the same address.
+/// Stores that provably write to other places, either on other
+/// Allocas(global variables) or constant distance away on the same
+/// Alloca, are skipped during the walk. The walk stops at anything
+/// other than MemStore and MemLoad (e.g. PHI, EffectMerge, Call).
+class LoadEliminationReducer : public GraphEditor {
+  Graph& G;
+
+  // MemLoad -> End of its function
+  NodeMap<Node*> LoadEnds;
+
+  MemoryAlias MA;
+
+  // the memory state Store is built on, looking through the
+  // MemLoads it depends on. Or nullptr if they disagree
+  Node* GetPrevState(Node* Store) const;
+  // MemLoad that reads the same address as Load from State
+  Node* FindLoad(Node* State, Node* Load) const;
+
+  GraphReduction ReduceMemoryLoad(Node* N);
+
+public:
+  static constexpr
+  const char* name() { return "load-elimination"; }
+
+  explicit LoadEliminationReducer(GraphEditor::Interface* editor);
+
+  GraphReduction Reduce(Node* N);
+};
+} // end namespace gross
+#endif
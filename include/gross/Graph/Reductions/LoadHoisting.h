@@ -0,0 +1,44 @@
+#ifndef GROSS_GRAPH_REDUCTIONS_LOAD_HOISTING_H
+#define GROSS_GRAPH_REDUCTIONS_LOAD_HOISTING_H
+#include "gross/Graph/GraphReducer.h"
+#include "gross/Graph/Node.h"
+#include "gross/Graph/NodeMap.h"
+#include "gross/Graph/Reductions/LoopAnalysis.h"
+#include "gross/Graph/Reductions/MemoryAlias.h"
+
+namespace gross {
+/// Move loop invariant MemLoads out of loops. That is, MemLoads whose
+/// base address and offset don't change within the loop, and no
+/// MemStore on the loop's effect chain might write to. The effect
+/// input of such MemLoad is rewired from the loop's effect PHI to
+/// the memory state before entering the loop, so it can be scheduled
+/// in the preheader.
+/// Calls, or anything else other than MemStore, MemLoad, PHI and
+/// EffectMerge on the effect chain of the loop prevent the hoisting.
+class LoadHoistingReducer : public GraphEditor {
+  Graph& G;
+
+  // MemLoad -> End of its function
+  NodeMap<Node*> LoadEnds;
+
+  MemoryAlias MA;
+
+  LoopAnalysis LA;
+
+  // whether any MemStore or Call on the effect chain of the loop,
+  // which goes from Backedge all the way up to LoopPHI, might
+  // write to the address read by Load
+  bool IsClobberedInLoop(Node* Load, Node* LoopPHI, Node* Backedge);
+
+  GraphReduction ReduceMemoryLoad(Node* N);
+
+public:
+  static constexpr
+  const char* name() { return "load-hoisting"; }
+
+  explicit LoadHoistingReducer(GraphEditor::Interface* editor);
+
+  GraphReduction Reduce(Node* N);
+};
+} // end namespace gross
+#endif
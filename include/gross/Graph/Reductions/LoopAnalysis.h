@@ -0,0 +1,48 @@
+#ifndef GROSS_GRAPH_REDUCTIONS_LOOP_ANALYSIS_H
+#define GROSS_GRAPH_REDUCTIONS_LOOP_ANALYSIS_H
+#include "gross/Graph/Graph.h"
+#include "gross/Graph/Node.h"
+#include <cstdint>
+#include <map>
+#include <utility>
+
+namespace gross {
+/// Queries on the loops of a function: whether a node is evaluated
+/// within a loop, and the induction variables of a loop.
+/// A basic induction variable is a loop PHI in the form of
+/// i <- PHI(Init, i + Step), where Step is a constant.
+class LoopAnalysis {
+  const Graph& G;
+
+  // {Node, Loop} -> whether Node is evaluated within Loop
+  std::map<std::pair<Node*, Node*>, bool> InLoopCache;
+
+  // whether control node Ctrl is enclosed by Loop
+  static bool IsCtrlInLoop(Node* Ctrl, Node* Loop);
+
+public:
+  struct InductionVariable {
+    Node* PHI;
+    Node* Loop;
+    Node* Init;
+    // i + Step
+    Node* Next;
+    int32_t Step;
+  };
+
+  explicit LoopAnalysis(const Graph& graph) : G(graph) {}
+
+  bool IsInLoop(Node* N, Node* Loop);
+  // cached results are stale after nodes are moved out of loops
+  void invalidate() { InLoopCache.clear(); }
+
+  // return false if PHI is not a basic induction variable
+  bool GetInductionVariable(Node* PHI, InductionVariable& IV) const;
+
+  // whether N is in the form of IV * Scale + Rest, where Rest is
+  // loop invariant. Only additions, subtractions and multiplications
+  // by constants are looked through
+  bool GetScale(Node* N, const InductionVariable& IV, int32_t& Scale);
+};
+} // end namespace gross
+#endif
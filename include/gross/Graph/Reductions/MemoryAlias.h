@@ -0,0 +1,35 @@
+#ifndef GROSS_GRAPH_REDUCTIONS_MEMORY_ALIAS_H
+#define GROSS_GRAPH_REDUCTIONS_MEMORY_ALIAS_H
+#include "gross/Graph/Graph.h"
+#include "gross/Graph/Node.h"
+#include <cstdint>
+
+namespace gross {
+/// Alias query between two memory nodes(i.e. MemLoad and MemStore).
+/// Every Alloca(including global variables) is a distinct memory
+/// object, and offsets on the same Alloca are compared in the
+/// form of Term * Scale + Const
+class MemoryAlias {
+  const Graph& G;
+
+  // Term is nullptr if the offset is a constant
+  struct LinearOffset {
+    Node* Term;
+    int64_t Scale;
+    int64_t Const;
+  };
+  LinearOffset Decompose(Node* Offset) const;
+
+public:
+  enum Result {
+    NoAlias,
+    MayAlias,
+    MustAlias
+  };
+
+  explicit MemoryAlias(const Graph& graph) : G(graph) {}
+
+  Result Query(Node* Mem1, Node* Mem2) const;
+};
+} // end namespace gross
+#endif
@@ -18,6 +18,9 @@ public:
   static constexpr
   const char* name() { return "peephole"; }
 
+  // see _detail::IsFunctionLocalReducer
+  static constexpr bool IsFunctionLocal = true;
+
   GraphReduction Reduce(Node* N);
 };
 } // end namespace gross
@@ -0,0 +1,53 @@
+#ifndef GROSS_GRAPH_REDUCTIONS_STRENGTH_REDUCTION_H
+#define GROSS_GRAPH_REDUCTIONS_STRENGTH_REDUCTION_H
+#include "gross/Graph/GraphReducer.h"
+#include "gross/Graph/Node.h"
+#include "gross/Graph/Reductions/LoopAnalysis.h"
+#include <cstdint>
+#include <map>
+
+namespace gross {
+/// Strength reduction on the address computations of basic induction
+/// variables. Every memory offset in the form of i * Scale + Rest,
+/// where Rest is loop invariant, is rewritten into p + Rest, in which
+/// p <- PHI(Init * Scale, p + Step * Scale) is a new induction variable.
+/// The loop exit test on i is rewritten on p as well (i.e. linear
+/// function test replacement), assuming no signed overflow.
+/// This is only done if every user of i can be rewritten, such that i
+/// and the multiplications on it are gone, instead of competing for
+/// registers with p.
+class StrengthReductionReducer : public GraphEditor {
+  Graph& G;
+
+  LoopAnalysis LA;
+
+  // builders that fold constants
+  Node* BuildAdd(Node* LHS, Node* RHS);
+  Node* BuildSub(Node* LHS, Node* RHS);
+  Node* BuildMul(Node* LHS, int32_t Factor);
+  // N with IV being replaced by zero, which is loop invariant
+  Node* GetRest(Node* N, const LoopAnalysis::InductionVariable& IV,
+                std::map<Node*, Node*>& Rests);
+
+  // Scale -> the derived induction variable
+  using derived_map = std::map<int32_t, Node*>;
+  Node* GetDerivedIV(const LoopAnalysis::InductionVariable& IV,
+                     int32_t Scale, derived_map& DerivedIVs);
+
+  // whether N compares Val, which is in the form of i + Rest,
+  // against loop invariant value
+  bool IsExitTest(Node* N, Node* Val,
+                  const LoopAnalysis::InductionVariable& IV);
+
+  GraphReduction ReducePhiNode(Node* N);
+
+public:
+  static constexpr
+  const char* name() { return "strength-reduction"; }
+
+  explicit StrengthReductionReducer(GraphEditor::Interface* editor);
+
+  GraphReduction Reduce(Node* N);
+};
+} // end namespace gross
+#endif
@@ -1,6 +1,9 @@
 #ifndef GROSS_GRAPH_REDUCTIONS_VALUE_PROMOTION_H
 #define GROSS_GRAPH_REDUCTIONS_VALUE_PROMOTION_H
 #include "gross/Graph/GraphReducer.h"
+#include <map>
+#include <utility>
+#include <vector>
 
 namespace gross {
 class ValuePromotion : public GraphEditor {
@@ -24,5 +27,35 @@ public:
 
   GraphReduction Reduce(Node* N);
 };
+
+/// Split local arrays that are only accessed by constant offsets
+/// into SSA values of each element, with PHIs built along their
+/// effect chains.
+class ArrayPromotion : public GraphEditor {
+  Graph& G;
+  Node* ZeroNode;
+
+  // memory nodes of an Alloca and all the PHIs / EffectMerges
+  // on its effect chains. Return false if there are other
+  // nodes involved
+  bool CollectMemoryNodes(Node* Alloca, std::vector<Node*>& Nodes);
+
+  using value_cache_type = std::map<std::pair<Node*, Node*>, Node*>;
+  // value of the element at Offset in memory State
+  Node* GetElementValue(Node* State, Node* Offset,
+                        value_cache_type& Cache,
+                        std::vector<Node*>& NewPHIs);
+  void RemoveTrivialPHIs(std::vector<Node*>& PHIs);
+
+  GraphReduction ReduceAlloca(Node* N);
+
+public:
+  explicit ArrayPromotion(GraphEditor::Interface* editor);
+
+  static constexpr
+  const char* name() { return "array-promotion"; }
+
+  GraphReduction Reduce(Node* N);
+};
 } // end namespace gross
 #endif
@@ -0,0 +1,74 @@
+#ifndef GROSS_SUPPORT_ALLOCATOR_H
+#define GROSS_SUPPORT_ALLOCATOR_H
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace gross {
+/// Bump allocator for objects of type T. Objects are placed
+/// contiguously in fixed-size slabs and are destroyed all at
+/// once when the allocator goes away.
+template<class T, size_t SlabSize = 256>
+class SpecificBumpAllocator {
+  using StorageTy
+    = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+  using SlabTy = std::unique_ptr<StorageTy[]>;
+
+  std::vector<SlabTy> Slabs;
+  // number of allocated objects in the last slab
+  size_t CurIdx;
+
+  void Reset() {
+    for(size_t i = 0, E = Slabs.size(); i < E; ++i) {
+      size_t N = (i + 1 == E)? CurIdx : SlabSize;
+      auto* Objs = reinterpret_cast<T*>(Slabs[i].get());
+      for(size_t j = 0; j < N; ++j)
+        Objs[j].~T();
+    }
+    Slabs.clear();
+    CurIdx = SlabSize;
+  }
+
+public:
+  SpecificBumpAllocator() : CurIdx(SlabSize) {}
+
+  SpecificBumpAllocator(const SpecificBumpAllocator&) = delete;
+  SpecificBumpAllocator& operator=(const SpecificBumpAllocator&) = delete;
+
+  SpecificBumpAllocator(SpecificBumpAllocator&& Other)
+    : Slabs(std::move(Other.Slabs)),
+      CurIdx(Other.CurIdx) {
+    Other.Slabs.clear();
+    Other.CurIdx = SlabSize;
+  }
+
+  ~SpecificBumpAllocator() { Reset(); }
+
+  /// Raw storage for a single T. The caller is responsible
+  /// to construct the object in-place
+  void* Allocate() {
+    if(CurIdx >= SlabSize) {
+      Slabs.emplace_back(new StorageTy[SlabSize]);
+      CurIdx = 0;
+    }
+    return &Slabs.back()[CurIdx++];
+  }
+
+  /// Only the most recently allocated storage can be returned,
+  /// this is used when the construction of object failed
+  void Deallocate(void* Ptr) {
+    assert(!Slabs.empty() && CurIdx > 0);
+    assert(Ptr == &Slabs.back()[CurIdx - 1] &&
+           "Can only deallocate the last allocation");
+    --CurIdx;
+  }
+
+  size_t size() const {
+    return Slabs.empty()? 0 : (Slabs.size() - 1) * SlabSize + CurIdx;
+  }
+  size_t getNumSlabs() const { return Slabs.size(); }
+};
+} // end namespace gross
+#endif
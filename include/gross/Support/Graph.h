@@ -3,9 +3,7 @@
 #include "boost/iterator/iterator_facade.hpp"
 #include "boost/graph/properties.hpp"
 #include "gross/Graph/Node.h"
-#include "gross/Support/type_traits.h"
 #include <vector>
-#include <set>
 
 namespace gross {
 // map from vertex or edge to an unique id
@@ -82,60 +80,6 @@ public:
   }
 };
 
-// Basically a BFS traversal iterator
-template<class GraphT, bool IsConst,
-         typename NodeT = gross::conditional_t<IsConst, const Node*, Node*>>
-class lazy_node_iterator
-  : public boost::iterator_facade<lazy_node_iterator<GraphT,IsConst,NodeT>,
-                                  NodeT, // Value type
-                                  boost::forward_traversal_tag, // Traversal tag
-                                  NodeT // Reference type
-                                  > {
-  friend class boost::iterator_core_access;
-  std::vector<NodeT> Queue;
-  // we use ADT instead of NodeMarker because
-  // the latter will make empty iterator(i.e. default ctor)
-  // more difficult
-  std::set<NodeT> Visited;
-
-  void Enqueue(NodeT N) {
-    Queue.push_back(N);
-    Visited.insert(N);
-  }
-
-  bool equal(const lazy_node_iterator& Other) const {
-    if(Queue.size() != Other.Queue.size()) return false;
-    if(!Queue.size()) return true;
-    // deep compare
-    for(auto I1 = Queue.cbegin(), I2 = Other.Queue.cbegin(),
-             E1 = Queue.cend(), E2 = Other.Queue.cend();
-        I1 != E1 && I2 != E2; ++I1, ++I2) {
-      if(*I1 != *I2) return false;
-    }
-    return true;
-  }
-
-  NodeT dereference() const {
-    assert(!Queue.empty());
-    return Queue.front();
-  }
-
-  void increment() {
-    NodeT Top = Queue.front();
-    Queue.erase(Queue.begin());
-    for(NodeT N : Top->inputs()) {
-      if(Visited.count(N)) continue;
-      Enqueue(N);
-    }
-  }
-
-public:
-  lazy_node_iterator() = default;
-  explicit lazy_node_iterator(NodeT EndNode) {
-    Enqueue(EndNode);
-  }
-};
-
 // since boost::depth_first_search has some really STUPID
 // copy by value ColorMap parameter, we need some stub/proxy
 // to hold map storage across several usages.
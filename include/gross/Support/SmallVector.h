@@ -0,0 +1,263 @@
+#ifndef GROSS_SUPPORT_SMALLVECTOR_H
+#define GROSS_SUPPORT_SMALLVECTOR_H
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+
+namespace gross {
+/// A vector-like container which stores the first N elements
+/// inline and only goes to heap when it grows beyond that.
+/// Only trivially copyable element types are supported, so
+/// elements can be relocated with plain memory copies.
+template<class T, unsigned N>
+class SmallVector {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only support trivially copyable element");
+  static_assert(N > 0, "Need at least one inline element");
+
+  T* Begin;
+  uint32_t Size;
+  uint32_t Capacity;
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type Inline[N];
+
+  T* getInlineStorage() { return reinterpret_cast<T*>(&Inline[0]); }
+  const T* getInlineStorage() const {
+    return reinterpret_cast<const T*>(&Inline[0]);
+  }
+  bool isSmall() const { return Begin == getInlineStorage(); }
+
+  void grow(size_t MinCapacity) {
+    size_t NewCap = std::max<size_t>(MinCapacity, size_t(Capacity) * 2);
+    auto* NewBegin = static_cast<T*>(std::malloc(NewCap * sizeof(T)));
+    assert(NewBegin && "Out of memory");
+    std::memcpy(NewBegin, Begin, Size * sizeof(T));
+    if(!isSmall()) std::free(Begin);
+    Begin = NewBegin;
+    Capacity = NewCap;
+  }
+
+  void resetToSmall() {
+    Begin = getInlineStorage();
+    Size = 0;
+    Capacity = N;
+  }
+
+  // whether First points into this container. Such range is
+  // invalidated once the elements are reallocated or shifted
+  template<class IterT>
+  typename std::enable_if<std::is_convertible<IterT, const T*>::value,
+                          bool>::type
+  isInternalRange(IterT First, IterT Last) const {
+    const T* F = First;
+    return First != Last &&
+           !std::less<const T*>{}(F, begin()) &&
+           std::less<const T*>{}(F, end());
+  }
+  template<class IterT>
+  typename std::enable_if<!std::is_convertible<IterT, const T*>::value,
+                          bool>::type
+  isInternalRange(IterT, IterT) const { return false; }
+
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = T*;
+  using const_iterator = const T*;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  SmallVector() { resetToSmall(); }
+
+  SmallVector(std::initializer_list<T> IL) {
+    resetToSmall();
+    append(IL.begin(), IL.end());
+  }
+
+  template<class IterT>
+  SmallVector(IterT First, IterT Last) {
+    resetToSmall();
+    append(First, Last);
+  }
+
+  SmallVector(const SmallVector& Other) {
+    resetToSmall();
+    append(Other.begin(), Other.end());
+  }
+
+  SmallVector(SmallVector&& Other) {
+    resetToSmall();
+    *this = std::move(Other);
+  }
+
+  ~SmallVector() {
+    if(!isSmall()) std::free(Begin);
+  }
+
+  SmallVector& operator=(const SmallVector& Other) {
+    if(this == &Other) return *this;
+    clear();
+    append(Other.begin(), Other.end());
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& Other) {
+    if(this == &Other) return *this;
+    if(Other.isSmall()) {
+      clear();
+      append(Other.begin(), Other.end());
+      Other.clear();
+    } else {
+      // steal the heap buffer
+      if(!isSmall()) std::free(Begin);
+      Begin = Other.Begin;
+      Size = Other.Size;
+      Capacity = Other.Capacity;
+      Other.resetToSmall();
+    }
+    return *this;
+  }
+
+  iterator begin() { return Begin; }
+  iterator end() { return Begin + Size; }
+  const_iterator begin() const { return Begin; }
+  const_iterator end() const { return Begin + Size; }
+  const_iterator cbegin() const { return Begin; }
+  const_iterator cend() const { return Begin + Size; }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  size_t size() const { return Size; }
+  size_t capacity() const { return Capacity; }
+  bool empty() const { return Size == 0; }
+
+  reference operator[](size_t Idx) {
+    assert(Idx < Size && "Index out-of-bound");
+    return Begin[Idx];
+  }
+  const_reference operator[](size_t Idx) const {
+    assert(Idx < Size && "Index out-of-bound");
+    return Begin[Idx];
+  }
+  reference at(size_t Idx) { return (*this)[Idx]; }
+  const_reference at(size_t Idx) const { return (*this)[Idx]; }
+
+  reference front() { return (*this)[0]; }
+  const_reference front() const { return (*this)[0]; }
+  reference back() { return (*this)[Size - 1]; }
+  const_reference back() const { return (*this)[Size - 1]; }
+
+  void reserve(size_t NewCap) {
+    if(NewCap > Capacity) grow(NewCap);
+  }
+
+  void push_back(const T& Val) {
+    if(Size >= Capacity) {
+      // Val might be an element of this container
+      T Tmp = Val;
+      grow(Size + 1);
+      Begin[Size++] = Tmp;
+    } else {
+      Begin[Size++] = Val;
+    }
+  }
+
+  void resize(size_t NewSize, const T& Val = T()) {
+    if(NewSize > Size) {
+      reserve(NewSize);
+      std::fill(end(), Begin + NewSize, Val);
+    }
+    Size = NewSize;
+  }
+
+  void pop_back() {
+    assert(Size > 0);
+    --Size;
+  }
+
+  template<class IterT>
+  void append(IterT First, IterT Last) {
+    if(isInternalRange(First, Last)) {
+      SmallVector Tmp(First, Last);
+      append(Tmp.begin(), Tmp.end());
+      return;
+    }
+    size_t Num = std::distance(First, Last);
+    reserve(Size + Num);
+    std::copy(First, Last, end());
+    Size += Num;
+  }
+
+  iterator insert(iterator Pos, const T& Val) {
+    assert(Pos >= begin() && Pos <= end());
+    size_t Idx = Pos - Begin;
+    T Tmp = Val;
+    reserve(Size + 1);
+    Pos = Begin + Idx;
+    std::memmove(Pos + 1, Pos, (Size - Idx) * sizeof(T));
+    *Pos = Tmp;
+    ++Size;
+    return Pos;
+  }
+
+  template<class IterT>
+  iterator insert(iterator Pos, IterT First, IterT Last) {
+    assert(Pos >= begin() && Pos <= end());
+    if(isInternalRange(First, Last)) {
+      SmallVector Tmp(First, Last);
+      return insert(Pos, Tmp.begin(), Tmp.end());
+    }
+    size_t Idx = Pos - Begin;
+    size_t Num = std::distance(First, Last);
+    reserve(Size + Num);
+    Pos = Begin + Idx;
+    std::memmove(Pos + Num, Pos, (Size - Idx) * sizeof(T));
+    std::copy(First, Last, Pos);
+    Size += Num;
+    return Pos;
+  }
+
+  iterator erase(iterator Pos) {
+    assert(Pos >= begin() && Pos < end());
+    std::memmove(Pos, Pos + 1, (end() - Pos - 1) * sizeof(T));
+    --Size;
+    return Pos;
+  }
+
+  iterator erase(iterator First, iterator Last) {
+    assert(First >= begin() && First <= Last && Last <= end());
+    std::memmove(First, Last, (end() - Last) * sizeof(T));
+    Size -= Last - First;
+    return First;
+  }
+
+  void clear() { Size = 0; }
+
+  // release heap storage, if there is any
+  void shrink_to_fit() {
+    if(isSmall() || Size > N) return;
+    T* OldBegin = Begin;
+    Begin = getInlineStorage();
+    std::memcpy(Begin, OldBegin, Size * sizeof(T));
+    std::free(OldBegin);
+    Capacity = N;
+  }
+};
+} // end namespace gross
+#endif
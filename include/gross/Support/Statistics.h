@@ -0,0 +1,190 @@
+#ifndef GROSS_SUPPORT_STATISTICS_H
+#define GROSS_SUPPORT_STATISTICS_H
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gross {
+/// Global collector of compile time and counters.
+/// Both timer and counters are disabled by default, so
+/// instrumented code only pays for a flag check
+class Statistics {
+public:
+  struct TimeRecord {
+    std::string Phase;
+    // empty if it's a whole-module phase
+    std::string Function;
+    double WallTime, CPUTime; // in seconds
+  };
+
+private:
+  bool TimerEnabled, CounterEnabled;
+
+  // in the order of finishing
+  std::vector<TimeRecord> Timings;
+  // (group, name) -> value. Ordered to have stable output
+  std::map<std::pair<std::string, std::string>, uint64_t> Counters;
+
+  Statistics() : TimerEnabled(false), CounterEnabled(false) {}
+
+  static void printJSONString(std::ostream& OS, const std::string& Str) {
+    OS << '"';
+    for(char C : Str) {
+      if(C == '"' || C == '\\') OS << '\\';
+      OS << C;
+    }
+    OS << '"';
+  }
+
+public:
+  static Statistics& Get() {
+    static Statistics S;
+    return S;
+  }
+
+  void EnableTimer(bool Enable = true) { TimerEnabled = Enable; }
+  bool IsTimerEnabled() const { return TimerEnabled; }
+  void EnableCounter(bool Enable = true) { CounterEnabled = Enable; }
+  bool IsCounterEnabled() const { return CounterEnabled; }
+
+  void AddCounter(const char* Group, const char* Name, uint64_t Val = 1U) {
+    if(!CounterEnabled || !Val) return;
+    Counters[std::make_pair(std::string(Group), std::string(Name))] += Val;
+  }
+  uint64_t GetCounter(const char* Group, const char* Name) const {
+    auto It = Counters.find(std::make_pair(std::string(Group),
+                                           std::string(Name)));
+    return It != Counters.end()? It->second : 0U;
+  }
+
+  void AddTime(TimeRecord&& Record) {
+    if(TimerEnabled) Timings.push_back(std::move(Record));
+  }
+  const std::vector<TimeRecord>& timings() const { return Timings; }
+
+  void clear() {
+    Timings.clear();
+    Counters.clear();
+  }
+
+  // human readable report
+  void print(std::ostream& OS) const {
+    if(TimerEnabled) {
+      auto Flags = OS.flags();
+      auto Precision = OS.precision();
+      double TotalWall = 0.0, TotalCPU = 0.0;
+      for(const auto& TR : Timings) {
+        if(!TR.Function.empty()) continue;
+        TotalWall += TR.WallTime;
+        TotalCPU += TR.CPUTime;
+      }
+      OS << "===--- Pass execution timing report ---===\n"
+         << "  Total: " << std::fixed << std::setprecision(4)
+         << TotalWall << "s wall, " << TotalCPU << "s CPU\n\n"
+         << "   Wall(s)     CPU(s)  Phase\n";
+      for(const auto& TR : Timings) {
+        OS << std::setw(10) << TR.WallTime << " "
+           << std::setw(10) << TR.CPUTime << "  ";
+        if(!TR.Function.empty())
+          OS << "  " << TR.Phase << " [" << TR.Function << "]\n";
+        else
+          OS << TR.Phase << "\n";
+      }
+      OS << "\n";
+      OS.flags(Flags);
+      OS.precision(Precision);
+    }
+    if(CounterEnabled) {
+      OS << "===--- Statistics ---===\n";
+      for(const auto& C : Counters) {
+        OS << std::setw(10) << C.second << "  "
+           << C.first.first << " - " << C.first.second << "\n";
+      }
+      OS << "\n";
+    }
+  }
+
+  void printJSON(std::ostream& OS) const {
+    OS << "{\n  \"timings\": [";
+    bool First = true;
+    for(const auto& TR : Timings) {
+      OS << (First? "\n" : ",\n") << "    {\"phase\": ";
+      printJSONString(OS, TR.Phase);
+      if(!TR.Function.empty()) {
+        OS << ", \"function\": ";
+        printJSONString(OS, TR.Function);
+      }
+      OS << ", \"wall\": " << TR.WallTime
+         << ", \"cpu\": " << TR.CPUTime << "}";
+      First = false;
+    }
+    OS << (First? "],\n" : "\n  ],\n");
+
+    OS << "  \"counters\": {";
+    First = true;
+    const std::string* LastGroup = nullptr;
+    for(const auto& C : Counters) {
+      const auto& Group = C.first.first;
+      if(!LastGroup || *LastGroup != Group) {
+        if(LastGroup) OS << "\n    }";
+        OS << (First? "\n    " : ",\n    ");
+        printJSONString(OS, Group);
+        OS << ": {";
+        LastGroup = &Group;
+        First = true;
+      }
+      OS << (First? "\n      " : ",\n      ");
+      printJSONString(OS, C.first.second);
+      OS << ": " << C.second;
+      First = false;
+    }
+    OS << (LastGroup? "\n    }\n  }\n}\n" : "}\n}\n");
+  }
+};
+
+/// RAII timer that records wall and CPU time of a phase
+/// into Statistics if timer is enabled
+class PassTimer {
+  using clock_type = std::chrono::steady_clock;
+
+  bool Active;
+  const char* Phase;
+  std::string Function;
+  clock_type::time_point WallStart;
+  std::clock_t CPUStart;
+
+public:
+  explicit PassTimer(const char* PhaseName,
+                     const std::string& FuncName = "")
+    : Active(Statistics::Get().IsTimerEnabled()),
+      Phase(PhaseName) {
+    if(!Active) return;
+    Function = FuncName;
+    WallStart = clock_type::now();
+    CPUStart = std::clock();
+  }
+
+  PassTimer(const PassTimer&) = delete;
+  PassTimer& operator=(const PassTimer&) = delete;
+
+  ~PassTimer() { Stop(); }
+
+  // record the time now instead of at the end of scope
+  void Stop() {
+    if(!Active) return;
+    Active = false;
+    std::chrono::duration<double> Wall = clock_type::now() - WallStart;
+    double CPU = static_cast<double>(std::clock() - CPUStart) /
+                 CLOCKS_PER_SEC;
+    Statistics::Get().AddTime({Phase, std::move(Function),
+                               Wall.count(), CPU});
+  }
+};
+} // end namespace gross
+#endif
@@ -3,21 +3,12 @@
 
 using namespace gross;
 
-BasicBlock::SeqNodeId* BasicBlock::getNodeId(Node* N) const {
-  if(NodeIds.count(N))
-    return const_cast<SeqNodeId*>(&NodeIds.at(N));
-  else
-    return nullptr;
-}
-
-size_t BasicBlock::getNodeIndex(Node* N) const {
-  auto Idx = 0U;
-  for(auto I = NodeSequence.begin(), E = NodeSequence.end(); I != E;
-      ++I, ++Idx) {
-    if(N == *I) return Idx;
+void BasicBlock::RenumberNodes() {
+  uint32_t Ordinal = 0U;
+  for(auto* N : NodeSequence) {
+    Ordinal += OrdinalStride;
+    NodeOrders.at(N).Ordinal = Ordinal;
   }
-  gross_unreachable("Node is not in BB?");
-  return 0;
 }
 
 bool BasicBlock::HasPredBlock(BasicBlock* BB) {
@@ -49,8 +40,22 @@ bool BasicBlock::RemoveSuccBlock(BasicBlock* BB) {
 void BasicBlock::AddNode(typename BasicBlock::node_iterator Pos,
                          Node* N) {
   LastNodeId = SeqNodeId::AdvanceFrom(LastNodeId);
-  NodeIds.insert({N, LastNodeId});
-  NodeSequence.insert(Pos, N);
+  auto NodeIt = NodeSequence.insert(Pos, N);
+  auto& Order = NodeOrders[N];
+  Order.Owner = this;
+  Order.Id = LastNodeId;
+
+  // take the middle of the gap between its neighbors
+  uint32_t Prev = 0U;
+  if(NodeIt != NodeSequence.begin())
+    Prev = NodeOrders.at(*std::prev(NodeIt)).Ordinal;
+  uint64_t Next = static_cast<uint64_t>(Prev) + 2U * OrdinalStride;
+  if(std::next(NodeIt) != NodeSequence.end())
+    Next = NodeOrders.at(*std::next(NodeIt)).Ordinal;
+  if(Next - Prev > 1U && Next <= UINT32_MAX)
+    Order.Ordinal = static_cast<uint32_t>(Prev + (Next - Prev) / 2U);
+  else
+    RenumberNodes();
 }
 
 bool BasicBlock::AddNodeBefore(Node* Before, Node* N) {
@@ -81,7 +86,8 @@ BasicBlock::RemoveNode(Node* N) {
                                });
   if(NodeIt == node_end())
     return std::make_pair(false, node_end());
-  NodeIds.erase(N);
+  if(NodeOrders.count(N) && NodeOrders.at(N).Owner == this)
+    NodeOrders.erase(N);
   return std::make_pair(true, NodeSequence.erase(NodeIt));
 }
 
@@ -144,10 +144,11 @@ struct NodeBuilder<IrOpcode::VirtDLXBinOps> {
 
   Node* Build() {
     assert(LHSVal && RHSVal);
-    auto* N = new Node(OC, {LHSVal, RHSVal});
-    LHSVal->Users.push_back(N);
-    RHSVal->Users.push_back(N);
+    if(auto* N = G->FindValueNumber(OC, LHSVal, RHSVal))
+      return N;
+    auto* N = new (*G) Node(OC, {LHSVal, RHSVal});
     G->InsertNode(N);
+    G->AddValueNumber(N);
     return N;
   }
 
@@ -167,10 +168,8 @@ struct NodeBuilder<IrOpcode::DLXLdW>
   Node* Build() {
     assert(OffsetNode->getOp() == IrOpcode::ConstantInt &&
            "Offset not constant?");
-    auto* N = new Node(IrOpcode::DLXLdW,
-                       {BaseAddrNode, OffsetNode});
-    BaseAddrNode->Users.push_back(N);
-    OffsetNode->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::DLXLdW,
+                            {BaseAddrNode, OffsetNode});
     G->InsertNode(N);
     return N;
   }
@@ -182,10 +181,8 @@ struct NodeBuilder<IrOpcode::DLXLdX>
     : _internal::MemNodeBuilder<IrOpcode::DLXLdX>(graph) {}
 
   Node* Build() {
-    auto* N = new Node(IrOpcode::DLXLdX,
-                       {BaseAddrNode, OffsetNode});
-    BaseAddrNode->Users.push_back(N);
-    OffsetNode->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::DLXLdX,
+                            {BaseAddrNode, OffsetNode});
     G->InsertNode(N);
     return N;
   }
@@ -205,12 +202,9 @@ struct NodeBuilder<IrOpcode::DLXStW>
   Node* Build() {
     assert(OffsetNode->getOp() == IrOpcode::ConstantInt &&
            "Offset not constant?");
-    auto* N = new Node(IrOpcode::DLXStW,
-                       {BaseAddrNode, OffsetNode,
-                        SrcNode});
-    BaseAddrNode->Users.push_back(N);
-    OffsetNode->Users.push_back(N);
-    SrcNode->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::DLXStW,
+                            {BaseAddrNode, OffsetNode,
+                             SrcNode});
     G->InsertNode(N);
     return N;
   }
@@ -230,12 +224,9 @@ struct NodeBuilder<IrOpcode::DLXStX>
   }
 
   Node* Build() {
-    auto* N = new Node(IrOpcode::DLXStX,
-                       {BaseAddrNode, OffsetNode,
-                        SrcNode});
-    BaseAddrNode->Users.push_back(N);
-    OffsetNode->Users.push_back(N);
-    SrcNode->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::DLXStX,
+                            {BaseAddrNode, OffsetNode,
+                             SrcNode});
     G->InsertNode(N);
     return N;
   }
@@ -259,10 +250,8 @@ struct NodeBuilder<IrOpcode::VirtDLXTriOps> {
   }
 
   Node* Build() {
-    auto* N = new Node(OC,
-                       {Vals[0], Vals[1], Vals[2]});
-    for(auto* V: Vals)
-      V->Users.push_back(N);
+    auto* N = new (*G) Node(OC,
+                            {Vals[0], Vals[1], Vals[2]});
     G->InsertNode(N);
     return N;
   }
@@ -281,10 +270,9 @@ struct NodeBuilder<IrOpcode::VirtDLXCallsiteEnd> {
 
   Node* Build() {
     assert(CallsiteBegin);
-    auto* N = new Node(IrOpcode::VirtDLXCallsiteEnd,
-                       {}, {},
-                       {CallsiteBegin});
-    CallsiteBegin->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::VirtDLXCallsiteEnd,
+                            {}, {},
+                            {CallsiteBegin});
     G->InsertNode(N);
     return N;
   }
@@ -307,11 +295,9 @@ struct NodeBuilder<IrOpcode::VirtDLXPassParam> {
 
   Node* Build() {
     assert(ParamVal && CallsiteBegin);
-    auto* N = new Node(IrOpcode::VirtDLXPassParam,
-                       {ParamVal}, {},
-                       {CallsiteBegin});
-    ParamVal->Users.push_back(N);
-    CallsiteBegin->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::VirtDLXPassParam,
+                            {ParamVal}, {},
+                            {CallsiteBegin});
     G->InsertNode(N);
     return N;
   }
@@ -330,9 +316,8 @@ struct NodeBuilder<IrOpcode::DLXRet> {
 
   Node* Build() {
     assert(LinkReg);
-    auto* N = new Node(IrOpcode::DLXRet,
-                       {LinkReg});
-    LinkReg->Users.push_back(N);
+    auto* N = new (*G) Node(IrOpcode::DLXRet,
+                            {LinkReg});
     G->InsertNode(N);
     return N;
   }
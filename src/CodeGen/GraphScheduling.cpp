@@ -6,10 +6,9 @@
 #include "gross/Graph/Node.h"
 #include "gross/Graph/NodeUtils.h"
 #include "DLXNodeUtils.h"
+#include <unordered_map>
 #include <unordered_set>
 #include <set>
-#include <functional>
-#include <queue>
 #include <vector>
 #include <iostream>
 
@@ -24,7 +23,8 @@ struct GraphSchedule::RPONodesVisitor
     PostEntity() : StartNode(nullptr), EndNode(nullptr) {}
   };
 
-  void finish_vertex(Node* N, const SubGraph& G) {
+  template<class GraphT>
+  void finish_vertex(Node* N, const GraphT& G) {
     switch(N->getOp()) {
     case IrOpcode::Start:
       PE.StartNode = N;
@@ -62,8 +62,9 @@ private:
   std::set<Node*> VisitedBranchPoints;
 };
 
-void GraphSchedule::SortRPONodes() {
-  auto BackEdgePatcher = [](const Use& OrigEdge) -> Use {
+// reverse back edges of loops
+struct GraphSchedule::BackEdgePatcher {
+  Use operator()(const Use& OrigEdge) const {
     auto* Source = OrigEdge.Source;
     NodeProperties<IrOpcode::Phi> PNP(Source);
     if(PNP && PNP.CtrlPivot()->getOp() == IrOpcode::Loop) {
@@ -99,18 +100,20 @@ void GraphSchedule::SortRPONodes() {
       }
     }
     return OrigEdge;
-  };
-  getSubGraph().SetEdgePatcher(BackEdgePatcher);
+  }
+};
 
+void GraphSchedule::SortRPONodes() {
   RPONodesVisitor::PostEntity PE;
   RPONodesVisitor Vis(RPONodes, PE);
-  std::unordered_map<Node*, boost::default_color_type> ColorStorage;
-  StubColorMap<decltype(ColorStorage), Node> ColorMap(ColorStorage);
-  boost::depth_first_search(getSubGraph(), Vis, std::move(ColorMap));
+  PatchedSubGraph<BackEdgePatcher> SG(getSubGraph());
+  std::vector<boost::default_color_type> ColorStorage(boost::num_vertices(SG));
+  auto ColorMap
+    = boost::make_iterator_property_map(ColorStorage.begin(),
+                                        boost::get(boost::vertex_index, SG));
+  boost::depth_first_search(SG, Vis, ColorMap);
   assert(PE.StartNode && PE.EndNode);
 
-  getSubGraph().ClearEdgePatcher();
-
   RPONodes.insert(RPONodes.begin(), PE.StartNode);
   RPONodes.push_back(PE.EndNode);
 }
@@ -146,10 +149,11 @@ size_t GraphSchedule::getWordAllocaSize() {
 BasicBlock* GraphSchedule::NewBasicBlock() {
   BasicBlock* BB;
   if(Blocks.empty())
-    BB = new BasicBlock();
+    BB = new BasicBlock(NodeOrders);
   else {
     auto& PrevBB = *Blocks.back().get();
-    BB = new BasicBlock(BasicBlock::Id::AdvanceFrom(PrevBB.getId()));
+    BB = new BasicBlock(NodeOrders,
+                        BasicBlock::Id::AdvanceFrom(PrevBB.getId()));
   }
   Blocks.emplace_back(BB);
   return Blocks.back().get();
@@ -171,162 +175,142 @@ size_t GraphSchedule::edge_size() {
   return std::distance(edge_begin(), edge_end());
 }
 
-// a simple BFS iterator
-struct GraphSchedule::DominatorNode::subdom_iterator {
-  using QueryCallbackTy
-    = std::function<DominatorNode*(BasicBlock*)>;
-
-  subdom_iterator(BasicBlock* Start, QueryCallbackTy CB)
-    : Query(CB) {
-    WorkQueue.push(Start);
-  }
-
-  BasicBlock* operator*() const {
-    return WorkQueue.front();
+// Cooper-Harvey-Kennedy's "A Simple, Fast Dominance Algorithm"
+void GraphSchedule::ComputeDominatorTree() {
+  DomNodes.clear();
+  LoopTree.clear();
+  auto* EntryBB = getEntryBlock();
+  assert(EntryBB);
+
+  // post order of the CFG
+  std::vector<BasicBlock*> POBlocks;
+  std::unordered_map<BasicBlock*, unsigned> PONumbers;
+  {
+    std::vector<std::pair<BasicBlock*, size_t>> Stack;
+    std::unordered_set<BasicBlock*> Visited{EntryBB};
+    Stack.push_back({EntryBB, 0U});
+    while(!Stack.empty()) {
+      auto& Top = Stack.back();
+      auto* BB = Top.first;
+      if(Top.second < BB->succ_size()) {
+        auto* SuccBB = *std::next(BB->succ_begin(), Top.second++);
+        if(Visited.insert(SuccBB).second)
+          Stack.push_back({SuccBB, 0U});
+        continue;
+      }
+      PONumbers[BB] = POBlocks.size();
+      POBlocks.push_back(BB);
+      Stack.pop_back();
+    }
   }
 
-  subdom_iterator& operator++() {
-    assert(!WorkQueue.empty());
-    auto* BB = WorkQueue.front();
-    WorkQueue.pop();
-    auto* DomNode = Query(BB);
-    if(DomNode) {
-      for(auto* NewBB : DomNode->doms())
-        WorkQueue.push(NewBB);
+  std::unordered_map<BasicBlock*, BasicBlock*> IDoms;
+  IDoms[EntryBB] = EntryBB;
+  auto intersect = [&](BasicBlock* BB1, BasicBlock* BB2) {
+    while(BB1 != BB2) {
+      while(PONumbers.at(BB1) < PONumbers.at(BB2))
+        BB1 = IDoms.at(BB1);
+      while(PONumbers.at(BB2) < PONumbers.at(BB1))
+        BB2 = IDoms.at(BB2);
+    }
+    return BB1;
+  };
+  bool Changed = true;
+  while(Changed) {
+    Changed = false;
+    // in RPO, skipping the entry block
+    for(auto BI = POBlocks.rbegin() + 1, BE = POBlocks.rend();
+        BI != BE; ++BI) {
+      auto* BB = *BI;
+      BasicBlock* NewIDom = nullptr;
+      for(auto* PredBB : BB->preds()) {
+        if(!IDoms.count(PredBB)) continue;
+        NewIDom = NewIDom? intersect(PredBB, NewIDom) : PredBB;
+      }
+      assert(NewIDom);
+      if(!IDoms.count(BB) || IDoms.at(BB) != NewIDom) {
+        IDoms[BB] = NewIDom;
+        Changed = true;
+      }
     }
-    return *this;
-  }
-  subdom_iterator operator++(int) {
-    subdom_iterator tmp(*this);
-    operator++();
-    return tmp;
   }
 
-  bool isEnd() const {
-    return WorkQueue.empty();
+  for(auto* BB : POBlocks)
+    DomNodes[BB] = gross::make_unique<DominatorNode>(BB);
+  // insert children in RPO for stable DomTree
+  for(auto BI = POBlocks.rbegin() + 1, BE = POBlocks.rend();
+      BI != BE; ++BI) {
+    auto* DomBB = IDoms.at(*BI);
+    DomNodes.at(*BI)->setDominator(DomBB);
+    DomNodes.at(DomBB)->AddDomChild(*BI);
   }
 
-private:
-    QueryCallbackTy Query;
-    std::queue<BasicBlock*> WorkQueue;
-};
-
-GraphSchedule::DominatorNode::subdom_iterator
-GraphSchedule::subdom_begin(BasicBlock* RootBB) {
-  using subdom_iterator = DominatorNode::subdom_iterator;
-  return subdom_iterator(RootBB,
-                         [this](BasicBlock* BB) -> DominatorNode* {
-                           if(DomNodes.count(BB))
-                             return DomNodes[BB].get();
-                           else
-                             return nullptr;
-                         });
-}
-
-// basically a tree reachbility problem
-bool GraphSchedule::Dominate(BasicBlock* FromBB, BasicBlock* ToBB) {
-  if(!DomNodes.count(FromBB) ||
-     !DomNodes.count(ToBB)) return false;
-  if(FromBB == ToBB) return true;
-
-  // BFS search
-  std::queue<BasicBlock*> Queue;
-  Queue.push(FromBB);
-  while(!Queue.empty()) {
-    auto* BB = Queue.front();
-    Queue.pop();
-    if(!DomNodes.count(BB)) continue;
-    auto* DomNode = DomNodes[BB].get();
-    for(auto* ChildBB : DomNode->doms()) {
-      if(ChildBB == ToBB) return true;
-      Queue.push(ChildBB);
+  // assign the DFS numbers and depths
+  unsigned DFSCounter = 0U;
+  std::vector<std::pair<DominatorNode*, size_t>> Stack;
+  std::vector<unsigned> DFSIns;
+  Stack.push_back({DomNodes.at(EntryBB).get(), 0U});
+  DFSIns.push_back(DFSCounter++);
+  while(!Stack.empty()) {
+    auto& Top = Stack.back();
+    auto* DN = Top.first;
+    if(Top.second < DN->dom_size()) {
+      auto* ChildDN
+        = DomNodes.at(*std::next(DN->dom_begin(), Top.second++)).get();
+      ChildDN->setDepth(DN->getDepth() + 1);
+      Stack.push_back({ChildDN, 0U});
+      DFSIns.push_back(DFSCounter++);
+      continue;
     }
+    DN->setDFSNumbers(DFSIns.back(), DFSCounter++);
+    DFSIns.pop_back();
+    Stack.pop_back();
   }
-  return false;
-}
 
-void GraphSchedule::ChangeDominator(BasicBlock* BB, BasicBlock* NewDomBB) {
-  assert(DomNodes.count(BB));
-  assert(DomNodes.count(NewDomBB));
-
-  std::vector<LoopTreeNode*> StagingLoopNodes;
-  // any loop header in (BB) subtree is invalid now
-  for(auto SDI = subdom_begin(BB); !SDI.isEnd(); ++SDI) {
-    auto* SubBB = *SDI;
-    if(SubBB->getCtrlNode()->getOp() == IrOpcode::Loop)
-      StagingLoopNodes.push_back(GetOrCreateLoopNode(SubBB));
-  }
+  ComputeLoopTree();
+}
 
-  auto* Node = DomNodes[BB].get();
-  auto* OldDomBB = Node->getDominator();
-  if(OldDomBB) {
-    assert(DomNodes.count(OldDomBB));
-    auto* OldDomNode = DomNodes[OldDomBB].get();
-    OldDomNode->RemoveDomChild(BB);
+void GraphSchedule::ComputeLoopTree() {
+  for(auto& P : DomNodes) {
+    auto* BB = P.first;
+    if(BB->getCtrlNode()->getOp() == IrOpcode::Loop)
+      GetOrCreateLoopNode(BB);
   }
-  Node->setDominator(NewDomBB);
-  auto* NewDomNode = DomNodes[NewDomBB].get();
-  NewDomNode->AddDomChild(BB);
 
-  // update LoopTree
-  for(auto* LoopNode : StagingLoopNodes) {
-    auto* HeaderBB = LoopNode->getHeader();
+  for(auto& P : LoopTree) {
+    auto* HeaderBB = P.first;
+    auto* LoopNode = P.second.get();
     // search upward until hitting another loop header
-    // or reach null
-    assert(DomNodes.count(HeaderBB));
-    auto* DN = DomNodes.at(HeaderBB).get();
+    // from its body, or reach null
     auto* PrevBB = HeaderBB;
-    auto* NewBB = DN->getDominator();
+    auto* NewBB = getDominator(HeaderBB);
     while(NewBB) {
       if(LoopTree.count(NewBB) &&
          PrevBB->getCtrlNode()->getOp() == IrOpcode::IfTrue)
         break;
-      assert(DomNodes.count(NewBB));
       PrevBB = NewBB;
-      DN = DomNodes.at(NewBB).get();
-      NewBB = DN->getDominator();
-    }
-    if(NewBB != LoopNode->getParent()) {
-      // remove the old link if any
-      if(auto* ParentHeader = LoopNode->getParent()) {
-        assert(LoopTree.count(ParentHeader));
-        LoopTree[ParentHeader]->RemoveChildLoop(HeaderBB);
-      }
-      if(NewBB) {
-        assert(LoopTree.count(NewBB));
-        LoopTree[NewBB]->AddChildLoop(HeaderBB);
-      }
-      LoopNode->setParent(NewBB);
+      NewBB = getDominator(NewBB);
     }
+    if(NewBB)
+      LoopTree.at(NewBB)->AddChildLoop(HeaderBB);
+    LoopNode->setParent(NewBB);
   }
 }
 
-void GraphSchedule::OnConnectBlock(BasicBlock* Pred, BasicBlock* Succ) {
-  if(!DomNodes.count(Pred))
-    DomNodes[Pred] = gross::make_unique<DominatorNode>(Pred);
-  if(!DomNodes.count(Succ))
-    DomNodes[Succ] = gross::make_unique<DominatorNode>(Succ);
-
-  // treat Pred as Succ's immediate Dominator
-  // if there is only one predecessor on Succ
-  if(Succ->pred_size() <= 1) {
-    ChangeDominator(Succ, Pred);
-  } else {
-    // search upward until BB dominate Pred and previous
-    // immediate dominator of Succ
-    auto* SuccNode = DomNodes[Succ].get();
-    auto* Dom = SuccNode->getDominator();
-    auto* NewDom = Dom;
-    while(NewDom &&
-          !(Dominate(NewDom, Dom) &&
-            Dominate(NewDom, Pred))) {
-      assert(DomNodes.count(NewDom));
-      auto* NewDomNode = DomNodes[NewDom].get();
-      NewDom = NewDomNode->getDominator();
-    }
-    assert(NewDom);
-    ChangeDominator(Succ, NewDom);
+BasicBlock* GraphSchedule::getCommonDominator(BasicBlock* BB1,
+                                              BasicBlock* BB2) {
+  if(!DomNodes.count(BB1) || !DomNodes.count(BB2)) return nullptr;
+  auto* DN1 = DomNodes.at(BB1).get();
+  auto* DN2 = DomNodes.at(BB2).get();
+  while(DN1->getDepth() > DN2->getDepth())
+    DN1 = DomNodes.at(DN1->getDominator()).get();
+  while(DN2->getDepth() > DN1->getDepth())
+    DN2 = DomNodes.at(DN2->getDominator()).get();
+  while(DN1 != DN2) {
+    DN1 = DomNodes.at(DN1->getDominator()).get();
+    DN2 = DomNodes.at(DN2->getDominator()).get();
   }
+  return DN1->getBlock();
 }
 
 namespace gross {
@@ -357,7 +341,6 @@ class CFGBuilder {
   void connectBlocks(BasicBlock* PredBB, BasicBlock* SuccBB) {
     PredBB->AddSuccBlock(SuccBB);
     SuccBB->AddPredBlock(PredBB);
-    Schedule.OnConnectBlock(PredBB, SuccBB);
   }
   void ConnectBlock(Node* CtrlNode);
 
@@ -373,6 +356,7 @@ public:
     for(auto* N : ControlNodes) {
       ConnectBlock(N);
     }
+    Schedule.ComputeDominatorTree();
   }
 };
 
@@ -535,158 +519,248 @@ void CFGBuilder::ConnectBlock(Node* CtrlNode) {
   }
 }
 
-class PostOrderNodePlacement {
+/// Click-style global code motion. Every floating node is
+/// bounded by the deepest block of its inputs(schedule early)
+/// and the common dominator of its users(schedule late). Then
+/// it is placed in the block with the shallowest loop nest
+/// between these two bounds.
+class GlobalCodeMotion {
   GraphSchedule& Schedule;
 
+  // number of loops enclosing a block
+  std::unordered_map<BasicBlock*, unsigned> LoopDepth;
+  // nullptr if there is no input bounded to any block
+  std::unordered_map<Node*, BasicBlock*> EarlyBlocks;
+
+  void ComputeLoopDepth();
+
   template<class SetT>
   BasicBlock* GetCommonDominator(const SetT& BBs);
 
-  BasicBlock* FindLoopInvariantPos(Node* N, BasicBlock* BB);
+  BasicBlock* ScheduleEarly(Node* N);
+  void ScheduleLate(Node* N);
 
 public:
-  PostOrderNodePlacement(GraphSchedule& schedule)
+  GlobalCodeMotion(GraphSchedule& schedule)
     : Schedule(schedule) {}
 
   void Compute();
 };
 
-template<class SetT> BasicBlock*
-PostOrderNodePlacement::GetCommonDominator(const SetT& BBs) {
-  // find the BB with smallest RPO index
-  auto BI = Schedule.po_begin(),
-       BIE = Schedule.po_end();
-  size_t Counter = 0U, BBSize = BBs.size();
-  for(; BI != BIE; ++BI) {
-    if(BBs.count(*BI)) ++Counter;
-    // we want to break on block that has the least RPO index
-    if(Counter >= BBSize) break;
-  }
-  for(; BI != BIE; ++BI) {
-    auto* DomBB = *BI;
-    bool Found = true;
-    for(auto* BB : BBs) {
-      if(!Schedule.Dominate(DomBB, BB)) {
-        Found = false;
-        break;
+void GlobalCodeMotion::ComputeLoopDepth() {
+  for(auto* BB : Schedule.rpo_blocks()) {
+    for(auto* SuccBB : BB->succs()) {
+      // back edge
+      if(!Schedule.Dominate(SuccBB, BB)) continue;
+      // collect the loop body from the tail
+      std::set<BasicBlock*> Body{SuccBB};
+      std::vector<BasicBlock*> Worklist{BB};
+      while(!Worklist.empty()) {
+        auto* CurBB = Worklist.back();
+        Worklist.pop_back();
+        if(!Body.insert(CurBB).second) continue;
+        for(auto* PredBB : CurBB->preds())
+          Worklist.push_back(PredBB);
       }
+      for(auto* BodyBB : Body) ++LoopDepth[BodyBB];
     }
-    if(Found) return DomBB;
   }
-  return nullptr;
 }
 
-BasicBlock* PostOrderNodePlacement::FindLoopInvariantPos(Node* CurNode,
-                                                         BasicBlock* OrigBB) {
-  auto* SafeBB = OrigBB;
-  auto* NewBB = OrigBB;
-  BasicBlock* LastLoopHeader = nullptr;
-  // find the closest loop
-  while(NewBB) {
-    if(Schedule.IsLoopHeader(NewBB)) {
-      LastLoopHeader = NewBB;
-    }
-    NewBB = Schedule.getDominator(NewBB);
-    if(LastLoopHeader) break;
+template<class SetT> BasicBlock*
+GlobalCodeMotion::GetCommonDominator(const SetT& BBs) {
+  BasicBlock* DomBB = nullptr;
+  for(auto* BB : BBs) {
+    DomBB = DomBB? Schedule.getCommonDominator(DomBB, BB) : BB;
+    if(!DomBB) break;
   }
-  if(!NewBB) return SafeBB;
-
-  // still need to be after all input nodes if scheduled
-  std::set<BasicBlock*> InputBBs;
-  for(auto* IN : CurNode->value_inputs()) {
-    if(Schedule.IsNodeScheduled(IN)) {
-      if(auto* InputBB = Schedule.MapBlock(IN)) {
-        InputBBs.insert(InputBB);
-      }
-    }
+  return DomBB;
+}
+
+// loads that can't go out of bounds. DLXMemoryLegalize addresses
+// Allocas top-down, so a word is within [-Size, -4]
+static bool IsInBoundsLoad(Node* N, const Graph& G) {
+  if(N->getOp() != IrOpcode::DLXLdW) return false;
+  auto* BaseAddr = N->getValueInput(0);
+  if(BaseAddr->getOp() != IrOpcode::Alloca) return false;
+  auto* Size = NodeProperties<IrOpcode::Alloca>(BaseAddr).Size();
+  auto* Offset = N->getValueInput(1);
+  if(Size->getOp() != IrOpcode::ConstantInt ||
+     Offset->getOp() != IrOpcode::ConstantInt)
+    return false;
+  auto SizeVal = NodeProperties<IrOpcode::ConstantInt>(Size)
+                 .as<int32_t>(G);
+  auto OffsetVal = NodeProperties<IrOpcode::ConstantInt>(Offset)
+                   .as<int32_t>(G);
+  return OffsetVal >= -SizeVal && OffsetVal <= -4;
+}
+
+// whether BB always runs into ToBB, e.g. loop
+// preheader into the loop header
+static bool AlwaysReaches(BasicBlock* BB, BasicBlock* ToBB) {
+  std::unordered_set<BasicBlock*> Visited;
+  while(BB != ToBB) {
+    if(BB->succ_size() != 1 || !Visited.insert(BB).second)
+      return false;
+    BB = *BB->succ_begin();
   }
-  for(auto* IN : CurNode->effect_inputs()) {
-    if(Schedule.IsNodeScheduled(IN)) {
-      if(auto* InputBB = Schedule.MapBlock(IN)) {
-        InputBBs.insert(InputBB);
-      }
-    }
+  return true;
+}
+
+// nodes that are safe to execute on paths that didn't
+// execute them before. Other loads can still move to the
+// blocks that always run into their original blocks (see
+// ScheduleLate). Either way, effect inputs keep loads below
+// the last modifications
+static bool IsSpeculatable(Node* N, const Graph& G) {
+  switch(N->getOp()) {
+#define DLX_ARITH_OP(OC)  \
+  case IrOpcode::DLX##OC: \
+  case IrOpcode::DLX##OC##I:
+#include "gross/Graph/DLXOpcodes.def"
+    break;
+  case IrOpcode::DLXLdW:
+  case IrOpcode::DLXLdX:
+    return IsInBoundsLoad(N, G);
+  default:
+    return false;
+  }
+  // division by zero might trap
+  switch(N->getOp()) {
+  case IrOpcode::DLXDiv:
+  case IrOpcode::DLXDivI:
+  case IrOpcode::DLXMod:
+  case IrOpcode::DLXModI:
+    return false;
+  default:
+    return true;
   }
+}
+
+// Hoisting N out of a loop keeps its result alive in the whole
+// loop. For an immediate arithmetic whose register operand has other
+// users, the operand stays alive as well, so one more register is
+// taken. With only a few registers that ends up as spill code,
+// which costs more than recomputing N in every iteration
+static bool IncreasesLoopPressure(Node* N) {
+  switch(N->getOp()) {
+#define DLX_ARITH_OP(OC)  \
+  case IrOpcode::DLX##OC##I:
+#include "gross/Graph/DLXOpcodes.def"
+    break;
+  default:
+    return false;
+  }
+  for(auto* VI : N->value_inputs()) {
+    if(NodeProperties<IrOpcode::VirtConstantValues>(VI)) continue;
+    if(VI->user_size(Use::K_VALUE) > 1) return true;
+  }
+  return false;
+}
+
+BasicBlock* GlobalCodeMotion::ScheduleEarly(Node* N) {
+  if(EarlyBlocks.count(N)) return EarlyBlocks.at(N);
+  if(Schedule.IsNodeScheduled(N))
+    return EarlyBlocks[N] = Schedule.MapBlock(N);
+  // break the cycles, which can only go through
+  // fixed nodes anyway
+  EarlyBlocks[N] = nullptr;
+
+  BasicBlock* EarlyBB = nullptr;
+  for(auto* Input : N->inputs()) {
+    auto* BB = ScheduleEarly(Input);
+    if(!BB) continue;
+    if(!EarlyBB || Schedule.getDomDepth(BB) > Schedule.getDomDepth(EarlyBB))
+      EarlyBB = BB;
+  }
+  return EarlyBlocks[N] = EarlyBB;
+}
 
-  auto isSafe = [this,&InputBBs](BasicBlock* BB) -> bool {
-    for(auto* InputBB : InputBBs) {
-      if(!Schedule.Dominate(InputBB, BB)) return false;
+void GlobalCodeMotion::ScheduleLate(Node* CurNode) {
+  // consider all the value users first
+  std::unordered_set<BasicBlock*> UserBBs;
+  std::unordered_set<Node*> UserNodes;
+  auto collectUsages = [&,this](Node* UN, Use::Kind UseKind) {
+    assert(Schedule.IsNodeScheduled(UN) &&
+           "User not scheduled?");
+    UserNodes.insert(UN);
+
+    BasicBlock* BB = nullptr;
+    if(UN->getOp() == IrOpcode::Phi) {
+      // don't need to dominate Phi block,
+      // use the branch block instead
+      NodeProperties<IrOpcode::Phi> PNP(UN);
+      auto* CN = PNP.MapCtrlNode(CurNode, UseKind);
+      assert(CN && "failed to map input to control node");
+      BB = Schedule.MapBlock(CN);
+    } else {
+      BB = Schedule.MapBlock(UN);
     }
-    return true;
+    assert(BB);
+    UserBBs.insert(BB);
   };
 
-  while(true) {
-    if(!isSafe(NewBB)) break;
-    SafeBB = NewBB;
+  for(auto* VU : CurNode->value_users()) {
+    collectUsages(VU, Use::K_VALUE);
+  }
+  for(auto* EU : CurNode->effect_users()) {
+    collectUsages(EU, Use::K_EFFECT);
+  }
+  if(UserBBs.empty()) return;
+
+  auto* LateBB = GetCommonDominator(UserBBs);
+  assert(LateBB);
+  auto* TargetBB = LateBB;
+  auto* EarlyBB = ScheduleEarly(CurNode);
+  bool Speculatable = IsSpeculatable(CurNode, Schedule.getGraph());
+  bool IsLoad = CurNode->getOp() == IrOpcode::DLXLdW ||
+                CurNode->getOp() == IrOpcode::DLXLdX;
+  if((Speculatable || IsLoad) && !IncreasesLoopPressure(CurNode) &&
+     (!EarlyBB || Schedule.Dominate(EarlyBB, LateBB))) {
+    // walk up the dominator tree and pick the
+    // shallowest loop nest, but as late as possible
+    for(auto* BB = LateBB; BB; BB = Schedule.getDominator(BB)) {
+      if(LoopDepth[BB] < LoopDepth[TargetBB] &&
+         (Speculatable || AlwaysReaches(BB, LateBB)))
+        TargetBB = BB;
+      if(BB == EarlyBB) break;
+    }
+  }
 
-    LastLoopHeader = Schedule.getParentLoop(LastLoopHeader);
-    if(!LastLoopHeader) break; // reach the root
-    NewBB = Schedule.getDominator(LastLoopHeader);
+  // search from top to bottom within the block,
+  // insert right before a value user if any. Otherwise
+  // insert at the end
+  auto NI = TargetBB->node_begin();
+  for(auto NE = TargetBB->node_end(); NI != NE; ++NI) {
+    auto* N = *NI;
+    if(UserNodes.count(N)) break;
+    // insert before terminate instructions
+    // FIXME: Is there any other way to generalize this
+    // concept
+    else if(NodeProperties<IrOpcode::VirtTerminate>(N))
+      break;
   }
-  return SafeBB;
+  Schedule.AddNode(TargetBB, NI, CurNode);
+  Schedule.SetScheduled(CurNode);
 }
 
-void PostOrderNodePlacement::Compute() {
-  for(auto* CurNode : Schedule.po_nodes()) {
-    if(Schedule.IsNodeScheduled(CurNode)) continue;
+void GlobalCodeMotion::Compute() {
+  ComputeLoopDepth();
+
+  // inputs are visited before their users. And the blocks of
+  // nodes fixed by CFGBuilder are known by now
+  for(auto* CurNode : Schedule.rpo_nodes()) {
     if(NodeProperties<IrOpcode::VirtConstantValues>(CurNode))
       continue;
+    ScheduleEarly(CurNode);
+  }
 
-    // consider all the value users first
-    std::unordered_set<BasicBlock*> UserBBs;
-    std::unordered_set<Node*> UserNodes;
-    auto collectUsages = [&,this](Node* UN, Use::Kind UseKind) {
-      assert(Schedule.IsNodeScheduled(UN) &&
-             "User not scheduled?");
-      UserNodes.insert(UN);
-
-      BasicBlock* BB = nullptr;
-      if(UN->getOp() == IrOpcode::Phi) {
-        // don't need to dominate Phi block,
-        // use the branch block instead
-        NodeProperties<IrOpcode::Phi> PNP(UN);
-        auto* CN = PNP.MapCtrlNode(CurNode, UseKind);
-        assert(CN && "failed to map input to control node");
-        BB = Schedule.MapBlock(CN);
-      } else {
-        BB = Schedule.MapBlock(UN);
-      }
-      assert(BB);
-      UserBBs.insert(BB);
-    };
-
-    for(auto* VU : CurNode->value_users()) {
-      collectUsages(VU, Use::K_VALUE);
-    }
-    for(auto* EU : CurNode->effect_users()) {
-      collectUsages(EU, Use::K_EFFECT);
-    }
-
-    if(!UserBBs.empty()) {
-      auto* DomBB = GetCommonDominator(UserBBs);
-      assert(DomBB);
-      // Don't put node in a loop
-      // FIXME: post-order placement is not suitable to do
-      // this kind of optimization as there is no input nodes
-      // scheduling information.
-      //DomBB = FindLoopInvariantPos(CurNode, DomBB);
-
-      // search from top to bottom within the block,
-      // insert right before a value user if any. Otherwise
-      // insert at the end
-      auto NI = DomBB->node_begin();
-      for(auto NE = DomBB->node_end(); NI != NE; ++NI) {
-        auto* N = *NI;
-        if(UserNodes.count(N)) break;
-        // insert before terminate instructions
-        // FIXME: Is there any other way to generalize this
-        // concept
-        else if(NodeProperties<IrOpcode::VirtTerminate>(N))
-          break;
-      }
-      Schedule.AddNode(DomBB, NI, CurNode);
-      Schedule.SetScheduled(CurNode);
+  // users are placed before their inputs
+  for(auto* CurNode : Schedule.po_nodes()) {
+    if(Schedule.IsNodeScheduled(CurNode)) continue;
+    if(NodeProperties<IrOpcode::VirtConstantValues>(CurNode))
       continue;
-    }
+    ScheduleLate(CurNode);
   }
 }
 } // end namespace _internal
@@ -1097,7 +1171,7 @@ void GraphScheduler::ComputeScheduledGraph() {
     CFB.Run();
 
     // Phase 2. Place rest of the nodes.
-    _internal::PostOrderNodePlacement POP(Schedule);
-    POP.Compute();
+    _internal::GlobalCodeMotion GCM(Schedule);
+    GCM.Compute();
   }
 }
@@ -1,4 +1,5 @@
 #include "BGL.h"
+#include "DLXNodeUtils.h"
 #include "boost/concept/assert.hpp"
 #include "boost/graph/graph_concepts.hpp"
 #include "gross/Graph/NodeUtils.h"
@@ -68,6 +69,22 @@ TEST(CodeGenUnitTest, GraphScheduleCFGSimpleCtrl) {
     std::ofstream OF("TestGraphScheduleCFGSimpleCtrl.after.dom.dot");
     FuncSchedule->dumpDomTreeGraphviz(OF);
   }
+  auto* EntryBB = FuncSchedule->getEntryBlock();
+  auto* TrueBB = FuncSchedule->MapBlock(TrueBr);
+  auto* FalseBB = FuncSchedule->MapBlock(FalseBr);
+  auto* TrueBB2 = FuncSchedule->MapBlock(TrueBr2);
+  auto* InnerBB = FuncSchedule->MapBlock(MergeInner);
+  auto* OuterBB = FuncSchedule->MapBlock(MergeOuter);
+  EXPECT_TRUE(FuncSchedule->Dominate(EntryBB, OuterBB));
+  EXPECT_TRUE(FuncSchedule->Dominate(TrueBB, TrueBB2));
+  EXPECT_TRUE(FuncSchedule->Dominate(TrueBB, InnerBB));
+  EXPECT_FALSE(FuncSchedule->Dominate(TrueBB, OuterBB));
+  EXPECT_FALSE(FuncSchedule->Dominate(FalseBB, TrueBB));
+  EXPECT_EQ(FuncSchedule->getDominator(InnerBB), TrueBB);
+  EXPECT_EQ(FuncSchedule->getDominator(OuterBB), EntryBB);
+  EXPECT_EQ(FuncSchedule->getCommonDominator(TrueBB2, InnerBB), TrueBB);
+  EXPECT_EQ(FuncSchedule->getCommonDominator(TrueBB2, FalseBB), EntryBB);
+  EXPECT_EQ(FuncSchedule->getDomDepth(TrueBB2), 2);
 }
 
 TEST(CodeGenUnitTest, GraphScheduleCFGSimpleLoop) {
@@ -483,3 +500,93 @@ TEST(CodeGenUnitTest, GraphScheduleMemNodePlacement) {
     }
   }
 }
+
+TEST(CodeGenUnitTest, GraphScheduleLoopInvariantPlacement) {
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_schedule_loop_invariant_placement")
+               .AddParameter(Arg)
+               .Build();
+  auto* Const0 = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* Const1 = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* Const4 = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+
+  auto* Loop = NodeBuilder<IrOpcode::Loop>(&G, Func)
+               .Condition(Const1).Build();
+  auto* PHINode = NodeBuilder<IrOpcode::Phi>(&G)
+                  .AddValueInput(Const0).AddValueInput(Const1)
+                  .SetCtrlMerge(Loop)
+                  .Build();
+  // a * 4 doesn't change within the loop
+  auto* Invariant
+    = NodeBuilder<IrOpcode::VirtDLXBinOps>(&G, IrOpcode::DLXMulI, true)
+      .LHS(Arg).RHS(Const4).Build();
+  auto* Sum
+    = NodeBuilder<IrOpcode::VirtDLXBinOps>(&G, IrOpcode::DLXAdd)
+      .LHS(PHINode).RHS(Invariant).Build();
+  PHINode->ReplaceUseOfWith(Const1, Sum, Use::K_VALUE);
+
+  NodeProperties<IrOpcode::Loop> LNP(Loop);
+  NodeProperties<IrOpcode::If> BNP(LNP.Branch());
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, PHINode).Build();
+  Return->appendControlInput(BNP.FalseBranch());
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+
+  GraphScheduler Scheduler(G);
+  Scheduler.ComputeScheduledGraph();
+  EXPECT_EQ(Scheduler.schedule_size(), 1);
+  auto* FuncSchedule = *Scheduler.schedule_begin();
+  {
+    std::ofstream OF("TestGraphScheduleLoopInvariantPlacement.after.dot");
+    FuncSchedule->dumpGraphviz(OF);
+  }
+  EXPECT_EQ(FuncSchedule->MapBlock(Sum),
+            FuncSchedule->MapBlock(BNP.TrueBranch()));
+  // hoisted out of the loop
+  EXPECT_EQ(FuncSchedule->MapBlock(Invariant),
+            FuncSchedule->getEntryBlock());
+}
+
+TEST(CodeGenUnitTest, GraphScheduleNodeOrdinals) {
+  Graph G;
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_schedule_node_ordinals")
+               .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func).Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+
+  GraphScheduler Scheduler(G);
+  Scheduler.ComputeScheduledGraph();
+  auto* FuncSchedule = *Scheduler.schedule_begin();
+  auto* EntryBB = FuncSchedule->getEntryBlock();
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  // keep inserting right after the first node, which
+  // runs out of gaps and triggers renumbering
+  for(int i = 0; i < 100; ++i) {
+    auto* Const = NodeBuilder<IrOpcode::ConstantInt>(&G, i).Build();
+    auto* N
+      = NodeBuilder<IrOpcode::VirtDLXBinOps>(&G, IrOpcode::DLXAddI, true)
+        .LHS(Arg).RHS(Const).Build();
+    FuncSchedule->AddNode(EntryBB, std::next(EntryBB->node_begin()), N);
+  }
+  ASSERT_EQ(EntryBB->getCtrlNode(), Func);
+  Node* PrevNode = nullptr;
+  for(auto* N : EntryBB->nodes()) {
+    EXPECT_TRUE(EntryBB->getNodeId(N));
+    if(PrevNode) {
+      EXPECT_LT(EntryBB->getNodeOrdinal(PrevNode),
+                EntryBB->getNodeOrdinal(N));
+    }
+    PrevNode = N;
+  }
+  // removed nodes are no longer numbered
+  auto* Second = *std::next(EntryBB->node_begin());
+  FuncSchedule->RemoveNode(EntryBB, Second);
+  EXPECT_FALSE(EntryBB->getNodeId(Second));
+}
@@ -17,6 +17,9 @@ public:
   static constexpr
   const char* name() { return "pre-machine-lowering"; }
 
+  // see _detail::IsFunctionLocalReducer
+  static constexpr bool IsFunctionLocal = true;
+
   GraphReduction Reduce(Node* N);
 };
 } // end namespace gross
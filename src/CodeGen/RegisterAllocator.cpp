@@ -1,7 +1,9 @@
 #include "RegisterAllocator.h"
 #include "Targets.h"
 #include "gross/Graph/NodeUtils.h"
+#include "gross/Support/Statistics.h"
 #include <algorithm>
+#include <map>
 
 using namespace gross;
 
@@ -47,6 +49,7 @@ Node* LinearScanRegisterAllocator<T>::CreateMove(Node* From) {
   auto* Move
     = NodeBuilder<IrOpcode::VirtDLXBinOps>(&G, IrOpcode::DLXAddI, true)
       .LHS(LHSVal).RHS(RHSVal).Build();
+  Statistics::Get().AddCounter("regalloc", "moves");
   return Move;
 }
 
@@ -220,7 +223,8 @@ std::vector<Node*>& LinearScanRegisterAllocator<T>::getOrderedUsers(Node* N) {
       : Schedule(schedule) {}
 
     bool operator()(const Node* Val1, const Node* Val2) const noexcept {
-      if(Val1 == Val2) return true;
+      // strict weak ordering required by std::sort
+      if(Val1 == Val2) return false;
       auto* N1 = const_cast<Node*>(Val1);
       auto* N2 = const_cast<Node*>(Val2);
       auto* BB1 = Schedule.MapBlock(N1);
@@ -233,8 +237,8 @@ std::vector<Node*>& LinearScanRegisterAllocator<T>::getOrderedUsers(Node* N) {
         return BBId1 < BBId2;
       } else {
         // in the same BB
-        auto NodeIdx1 = BB1->getNodeIndex(N1),
-             NodeIdx2 = BB1->getNodeIndex(N2);
+        auto NodeIdx1 = BB1->getNodeOrdinal(N1),
+             NodeIdx2 = BB1->getNodeOrdinal(N2);
         assert(NodeIdx1 != NodeIdx2 && "has the same node index?");
         return NodeIdx1 < NodeIdx2;
       }
@@ -272,7 +276,8 @@ bool LinearScanRegisterAllocator<T>::AssignRegister(Node* N) {
     }
   }
   if(PHIUsr && Assignment.count(PHIUsr)) {
-    auto& Loc = Assignment[PHIUsr];
+    // copy: inserting N might grow the table
+    auto Loc = Assignment.at(PHIUsr);
     if(!Loc.IsRegister()) return false;
     RegUsages[Loc.Index] = N;
     assert(!Assignment.count(N));
@@ -298,6 +303,7 @@ bool LinearScanRegisterAllocator<T>::AssignRegister(Node* N) {
 
 template<class T>
 void LinearScanRegisterAllocator<T>::Spill(Node* N) {
+  Statistics::Get().AddCounter("regalloc", "spills");
   Node* PHIUsr = nullptr;
   for(auto* VU : N->value_users()) {
     if(VU->getOp() == IrOpcode::Phi) {
@@ -307,7 +313,7 @@ void LinearScanRegisterAllocator<T>::Spill(Node* N) {
   }
   // also handle spilled stack parameter here!
   if(PHIUsr && Assignment.count(PHIUsr)) {
-    auto& Loc = Assignment[PHIUsr];
+    auto Loc = Assignment.at(PHIUsr);
     assert(!Loc.IsRegister());
     if(Loc.IsSpilledVal()) {
       SpillSlots[Loc.Index] = N;
@@ -322,7 +328,8 @@ void LinearScanRegisterAllocator<T>::Spill(Node* N) {
     // propagate the spilled param location
     if(PHIUsr) {
       assert(!Assignment.count(PHIUsr));
-      Assignment[PHIUsr] = Assignment.at(N);
+      auto Loc = Assignment.at(N);
+      Assignment[PHIUsr] = Loc;
     }
   } else {
     // spilled value
@@ -1,8 +1,7 @@
 #include "Frontend/Parser.h"
+#include "Driver/PassPipeline.h"
 #include "gross/Graph/NodeUtils.h"
-#include "gross/Graph/Reductions/CSE.h"
 #include "gross/Graph/Reductions/Peephole.h"
-#include "gross/Graph/Reductions/ValuePromotion.h"
 #include "gross/Graph/Reductions/MemoryLegalize.h"
 #include "CodeGen/PreMachineLowering.h"
 #include "gross/CodeGen/GraphScheduling.h"
@@ -11,9 +10,13 @@
 #include "CodeGen/Targets.h"
 #include "CodeGen/PostRALowering.h"
 #include "gross/Support/Log.h"
+#include "gross/Support/Statistics.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cctype>
+#include <string>
+#include <vector>
 #include <cxxopts.hpp>
 
 using namespace gross;
@@ -30,11 +33,30 @@ static std::string MakeName(size_t Idx,
   return SS.str();
 }
 
+static std::string GetFunctionName(const Graph& G,
+                                   const GraphSchedule& Schedule) {
+  auto* End = Schedule.getSubGraph().getTail();
+  for(auto* N : End->inputs()) {
+    if(N->getOp() == IrOpcode::Start)
+      return NodeProperties<IrOpcode::Start>(N).name(G);
+  }
+  return "";
+}
+
 static void InitializeCLIOptions(cxxopts::Options& Opts) {
   Opts.add_options()
     ("v,version", "Show version")
     ("h,help", "Show this message")
     ("i,input", "Input file", cxxopts::value<std::string>())
+    ("opt-level", "Optimization level, 0 to 2. Default is 1 (-O1)",
+     cxxopts::value<unsigned>())
+    ("passes", "Comma separated middle-end pipeline, overrides -O",
+     cxxopts::value<std::string>())
+    ("print-passes", "Print available passes of --passes")
+    ("j,jobs", "Number of threads reducing functions in parallel. "
+               "Only affects the 'peephole' pass and the peephole and "
+               "pre-machine-lowering passes before scheduling",
+     cxxopts::value<unsigned>())
     ("dump-hl", "Dump high-level graph (looks really like AST)")
     ("dump-mem2reg", "Result after ValuePromotion")
     ("dump-peephole", "Result after peephole optimization")
@@ -43,18 +65,42 @@ static void InitializeCLIOptions(cxxopts::Options& Opts) {
     ("dump-scheduled", "Scheduled graph")
     ("dump-post-lowering", "Result after PostMachineLowering")
     ("dump-ra", "Register allocated graph")
-    ("dump-post-ra", "Result after PostRALowering");
+    ("dump-post-ra", "Result after PostRALowering")
+    ("time-passes", "Report wall and CPU time of each phase")
+    ("stats", "Report statistics of each phase")
+    ("stats-json", "Write timing and statistics report to file in JSON",
+     cxxopts::value<std::string>());
   Opts.parse_positional({"input"});
 }
 
 int main(int argc, char** argv) {
   cxxopts::Options CLIOpts("gross", "GRaph Optimizer Soley for cS241");
   InitializeCLIOptions(CLIOpts);
-  auto GrossOpts = CLIOpts.parse(argc, argv);
+  // cxxopts doesn't support value attached to short option,
+  // so rewrite -O<N> into --opt-level=<N>
+  std::vector<std::string> Args(argv, argv + argc);
+  std::vector<char*> ArgPtrs;
+  for(auto& Arg : Args) {
+    if(Arg.size() == 3 && Arg[0] == '-' && Arg[1] == 'O' &&
+       std::isdigit(Arg[2]))
+      Arg = "--opt-level=" + Arg.substr(2);
+    ArgPtrs.push_back(&Arg[0]);
+  }
+  int NumArgs = argc;
+  char** ArgValues = ArgPtrs.data();
+  auto GrossOpts = CLIOpts.parse(NumArgs, ArgValues);
 
   if(GrossOpts.count("help")) {
     std::cout << CLIOpts.help() << "\n";
     return 0;
+  } else if(GrossOpts.count("print-passes")) {
+    for(const auto& PI : PassRegistry::passes()) {
+      std::cout << "  " << PI.Name << " - " << PI.Description
+                << (PI.IsRequired? " (required)\n" : "\n");
+    }
+    for(unsigned i = 0; i <= PassPipeline::MaxOptLevel; ++i)
+      std::cout << "-O" << i << ": " << PassPipeline::GetPreset(i) << "\n";
+    return 0;
   } else if(GrossOpts.count("version")) {
     std::cout << "v0.94.87\n";
     return 0;
@@ -72,12 +118,46 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  unsigned OptLevel = 1;
+  if(GrossOpts.count("opt-level")) {
+    OptLevel = GrossOpts["opt-level"].as<unsigned>();
+    if(OptLevel > PassPipeline::MaxOptLevel) {
+      Log::E() << "Invalid optimization level " << OptLevel << "\n";
+      return 1;
+    }
+  }
+  PassPipeline Pipeline;
+  if(!Pipeline.Parse(GrossOpts.count("passes")?
+                     GrossOpts["passes"].as<std::string>() :
+                     PassPipeline::GetPreset(OptLevel)))
+    return 1;
+
+  if(GrossOpts.count("jobs")) {
+    auto NumJobs = GrossOpts["jobs"].as<unsigned>();
+    if(!NumJobs) {
+      Log::E() << "Invalid number of jobs " << NumJobs << "\n";
+      return 1;
+    }
+    GraphReducer::SetNumJobs(NumJobs);
+  }
+
+  auto& Stats = Statistics::Get();
+  Stats.EnableTimer(GrossOpts.count("time-passes") ||
+                    GrossOpts.count("stats-json"));
+  Stats.EnableCounter(GrossOpts.count("stats") ||
+                      GrossOpts.count("stats-json"));
+
   Graph G;
+  // share identical arithmetic nodes upon creation
+  if(OptLevel > 0) G.EnableValueNumbering();
   Parser P(IF, G);
 
-  if(!P.Parse(true)) {
-    Log::E() << "Failed to parse\n";
-    return 1;
+  {
+    PassTimer Timer("parser");
+    if(!P.Parse(true)) {
+      Log::E() << "Failed to parse\n";
+      return 1;
+    }
   }
   if(GrossOpts.count("dump-hl")) {
     std::ofstream OF(MakeName(InputFileName, "parsed.dot"));
@@ -85,30 +165,40 @@ int main(int argc, char** argv) {
   }
 
   // Middle-end
-  GraphReducer::RunWithEditor<ValuePromotion>(G);
-  GraphReducer::RunWithEditor<MemoryLegalize>(G);
-  if(GrossOpts.count("dump-mem2reg")) {
-    std::ofstream OF(MakeName(InputFileName, "mem2reg.dot"));
-    G.dumpGraphviz(OF);
-  }
-  GraphReducer::RunWithEditor<PeepholeReducer>(G);
-  if(GrossOpts.count("dump-peephole")) {
-    std::ofstream OF(MakeName(InputFileName, "peephole.dot"));
-    G.dumpGraphviz(OF);
-  }
-  GraphReducer::RunWithEditor<CSEReducer>(G);
-  if(GrossOpts.count("dump-cse")) {
-    std::ofstream OF(MakeName(InputFileName, "cse.dot"));
-    G.dumpGraphviz(OF);
-  }
+  Pipeline.Run(G, [&](const PassRegistry::PassInfo& PI) {
+    std::string Name(PI.Name);
+    const char* DumpExt = nullptr;
+    if(Name == "memory-legalize" && GrossOpts.count("dump-mem2reg"))
+      DumpExt = "mem2reg.dot";
+    else if(Name == "peephole" && GrossOpts.count("dump-peephole"))
+      DumpExt = "peephole.dot";
+    else if(Name == "cse" && GrossOpts.count("dump-cse"))
+      DumpExt = "cse.dot";
+    else if(Name.find("peephole-cse") == 0) {
+      // fused peephole and CSE
+      if(GrossOpts.count("dump-peephole"))
+        DumpExt = "peephole.dot";
+      else if(GrossOpts.count("dump-cse"))
+        DumpExt = "cse.dot";
+    }
+    if(DumpExt) {
+      std::ofstream OF(MakeName(InputFileName, DumpExt));
+      G.dumpGraphviz(OF);
+    }
+  });
 
   // Preparation
-  DLXMemoryLegalize DLXMemLegalize(G);
-  DLXMemLegalize.Run();
+  {
+    PassTimer Timer("dlx-memory-legalize");
+    DLXMemoryLegalize DLXMemLegalize(G);
+    DLXMemLegalize.Run();
+  }
   if(GrossOpts.count("dump-pre-lowering")) {
     std::ofstream OF(MakeName(InputFileName, "prelower1.dot"));
     G.dumpGraphviz(OF);
   }
+  // always needed since PreMachineLowering expects
+  // constants being folded
   GraphReducer::RunWithEditor<PeepholeReducer>(G);
   if(GrossOpts.count("dump-pre-lowering")) {
     std::ofstream OF(MakeName(InputFileName, "prelower2.dot"));
@@ -120,34 +210,52 @@ int main(int argc, char** argv) {
     G.dumpGraphviz(OF);
   }
   // Lower to CFG
+  // nodes created from now on will be placed individually
+  G.EnableValueNumbering(false);
   GraphScheduler Scheduler(G);
-  Scheduler.ComputeScheduledGraph();
+  {
+    PassTimer Timer("graph-scheduler");
+    Scheduler.ComputeScheduledGraph();
+  }
+  PassTimer CodeGenTimer("code-generation");
   size_t Counter = 1;
   for(auto* FuncSchedule : Scheduler.schedules()) {
+    std::string FuncName;
+    if(Stats.IsTimerEnabled())
+      FuncName = GetFunctionName(G, *FuncSchedule);
     if(GrossOpts.count("dump-scheduled")) {
       std::ofstream OF(MakeName(Counter,
                                 InputFileName, "scheduled.dot"));
       FuncSchedule->dumpGraphviz(OF);
     }
 
-    PostMachineLowering PostLowering(*FuncSchedule);
-    PostLowering.Run();
+    {
+      PassTimer Timer("post-machine-lowering", FuncName);
+      PostMachineLowering PostLowering(*FuncSchedule);
+      PostLowering.Run();
+    }
     if(GrossOpts.count("dump-post-lowering")) {
       std::ofstream OF(MakeName(Counter,
                                 InputFileName, "postlower.dot"));
       FuncSchedule->dumpGraphviz(OF);
     }
 
-    LinearScanRegisterAllocator<CompactDLXTargetTraits> RA(*FuncSchedule);
-    RA.Allocate();
+    {
+      PassTimer Timer("register-allocation", FuncName);
+      LinearScanRegisterAllocator<CompactDLXTargetTraits> RA(*FuncSchedule);
+      RA.Allocate();
+    }
     if(GrossOpts.count("dump-ra")) {
       std::ofstream OF(MakeName(Counter,
                                 InputFileName, "ra.dot"));
       FuncSchedule->dumpGraphviz(OF);
     }
 
-    PostRALowering PostRA(*FuncSchedule);
-    PostRA.Run();
+    {
+      PassTimer Timer("post-ra-lowering", FuncName);
+      PostRALowering PostRA(*FuncSchedule);
+      PostRA.Run();
+    }
     if(GrossOpts.count("dump-post-ra")) {
       std::ofstream OF(MakeName(Counter,
                                 InputFileName, "postra.dot"));
@@ -155,5 +263,20 @@ int main(int argc, char** argv) {
     }
     Counter++;
   }
+  CodeGenTimer.Stop();
+
+  Stats.AddCounter("graph", "nodes-created", G.getNumNodeIds());
+  Stats.AddCounter("graph", "nodes", G.node_size());
+  if(GrossOpts.count("time-passes") || GrossOpts.count("stats"))
+    Stats.print(std::cerr);
+  if(GrossOpts.count("stats-json")) {
+    auto JSONFileName = GrossOpts["stats-json"].as<std::string>();
+    std::ofstream OF(JSONFileName);
+    if(!OF) {
+      Log::E() << "Failed to open file " << JSONFileName << "\n";
+      return 1;
+    }
+    Stats.printJSON(OF);
+  }
   return 0;
 }
@@ -0,0 +1,181 @@
+#include "PassPipeline.h"
+#include "gross/Graph/GraphReducer.h"
+#include "gross/Graph/Reductions/CSE.h"
+#include "gross/Graph/Reductions/DeadStoreElimination.h"
+#include "gross/Graph/Reductions/GVN.h"
+#include "gross/Graph/Reductions/LoadElimination.h"
+#include "gross/Graph/Reductions/LoadHoisting.h"
+#include "gross/Graph/Reductions/Peephole.h"
+#include "gross/Graph/Reductions/StrengthReduction.h"
+#include "gross/Graph/Reductions/ValuePromotion.h"
+#include "gross/Graph/Reductions/MemoryLegalize.h"
+#include "gross/Support/Log.h"
+#include <sstream>
+
+using namespace gross;
+
+// upper bound of iterations in 'peephole-cse-fixpoint' and
+// 'dead-store-elimination', in case of reducers that keep
+// reporting changes
+static constexpr unsigned MaxFixpointIterations = 8;
+
+static void RunValuePromotion(Graph& G) {
+  GraphReducer::RunWithEditor<ValuePromotion>(G);
+}
+static void RunArrayPromotion(Graph& G) {
+  GraphReducer::RunWithEditor<ArrayPromotion>(G);
+}
+static void RunMemoryLegalize(Graph& G) {
+  GraphReducer::RunWithEditor<MemoryLegalize>(G);
+}
+static void RunPeephole(Graph& G) {
+  GraphReducer::RunWithEditor<PeepholeReducer>(G);
+}
+static void RunCSE(Graph& G) {
+  GraphReducer::RunWithEditor<CSEReducer>(G);
+}
+static void RunPeepholeCSE(Graph& G) {
+  GraphReducer::Run<PeepholeReducer, CSEReducer>(G);
+}
+static void RunGVN(Graph& G) {
+  GraphReducer::RunWithEditor<GVNReducer>(G);
+}
+static void RunLoadElimination(Graph& G) {
+  GraphReducer::RunWithEditor<LoadEliminationReducer>(G);
+}
+static void RunLoadHoisting(Graph& G) {
+  GraphReducer::RunWithEditor<LoadHoistingReducer>(G);
+}
+static void RunStrengthReduction(Graph& G) {
+  GraphReducer::RunWithEditor<StrengthReductionReducer>(G);
+}
+static void RunDeadStoreElimination(Graph& G) {
+  // values of the removed stores are only swept after each run,
+  // and the loads computing them can be removed in the next run
+  for(unsigned i = 0; i < MaxFixpointIterations; ++i) {
+    if(!GraphReducer::RunWithEditor<DeadStoreEliminationReducer>(G))
+      break;
+  }
+}
+static void RunPeepholeCSEFixpoint(Graph& G) {
+  // every run starts from a fresh worklist and drops the
+  // dead nodes, which might expose more opportunities
+  for(unsigned i = 0; i < MaxFixpointIterations; ++i) {
+    if(!GraphReducer::Run<PeepholeReducer, CSEReducer>(G)) break;
+  }
+}
+
+const std::vector<PassRegistry::PassInfo>& PassRegistry::passes() {
+  static const std::vector<PassInfo> Passes = {
+    {"mem2reg", "Promote variables into SSA values",
+     true, RunValuePromotion},
+    {"memory-legalize", "Legalize memory operations",
+     true, RunMemoryLegalize},
+    {"peephole", "Peephole optimizations", false, RunPeephole},
+    {"cse", "Common subexpression elimination", false, RunCSE},
+    {"peephole-cse", "Peephole and CSE in a single traversal",
+     false, RunPeepholeCSE},
+    {"peephole-cse-fixpoint", "Repeat peephole-cse until nothing changes",
+     false, RunPeepholeCSEFixpoint},
+    {"array-promotion",
+     "Promote constant-indexed local arrays into SSA values",
+     false, RunArrayPromotion},
+    {"gvn", "Optimistic global value numbering", false, RunGVN},
+    {"load-elimination",
+     "Forward stored values and reuse loads along effect chains",
+     false, RunLoadElimination},
+    {"load-hoisting", "Move loop invariant loads out of loops",
+     false, RunLoadHoisting},
+    {"dead-store-elimination", "Remove stores that are never read",
+     false, RunDeadStoreElimination},
+    {"strength-reduction",
+     "Replace multiplications on loop induction variables with additions",
+     false, RunStrengthReduction}
+  };
+  return Passes;
+}
+
+const PassRegistry::PassInfo* PassRegistry::Find(const std::string& Name) {
+  for(const auto& PI : passes()) {
+    if(Name == PI.Name) return &PI;
+  }
+  return nullptr;
+}
+
+const char* PassPipeline::GetPreset(unsigned OptLevel) {
+  switch(OptLevel) {
+  case 0:
+    return "mem2reg,memory-legalize";
+  case 1:
+    return "mem2reg,memory-legalize,peephole-cse";
+  default:
+    return "mem2reg,memory-legalize,peephole-cse-fixpoint,"
+           "array-promotion,gvn,load-hoisting,load-elimination,"
+           "dead-store-elimination,strength-reduction";
+  }
+}
+
+bool PassPipeline::Parse(const std::string& Pipeline) {
+  Passes.clear();
+  std::stringstream SS(Pipeline);
+  std::string Name;
+  while(std::getline(SS, Name, ',')) {
+    if(Name.empty()) continue;
+    auto* PI = PassRegistry::Find(Name);
+    if(!PI) {
+      Log::E() << "Unknown pass '" << Name << "'\n";
+      return false;
+    }
+    Passes.push_back(PI);
+  }
+
+  // required passes should run exactly once, in the
+  // order they are registered
+  std::vector<const PassRegistry::PassInfo*> RequiredPasses;
+  for(auto* PI : Passes) {
+    if(PI->IsRequired) RequiredPasses.push_back(PI);
+  }
+  size_t Idx = 0;
+  for(const auto& PI : PassRegistry::passes()) {
+    if(!PI.IsRequired) continue;
+    if(!contains(PI.Name)) {
+      Log::E() << "Pass '" << PI.Name << "' is required by code generation\n";
+      return false;
+    }
+    if(RequiredPasses[Idx] != &PI) {
+      Log::E() << "Pass '" << PI.Name << "' should run before '"
+               << RequiredPasses[Idx]->Name << "'\n";
+      return false;
+    }
+    ++Idx;
+  }
+  if(Idx < RequiredPasses.size()) {
+    Log::E() << "Pass '" << RequiredPasses[Idx]->Name
+             << "' should only run once\n";
+    return false;
+  }
+  // optimizations work on legalized graph
+  for(auto* PI : Passes) {
+    if(PI == RequiredPasses.back()) break;
+    if(!PI->IsRequired) {
+      Log::E() << "Pass '" << PI->Name << "' should run after '"
+               << RequiredPasses.back()->Name << "'\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PassPipeline::contains(const char* Name) const {
+  for(auto* PI : Passes) {
+    if(PI == PassRegistry::Find(Name)) return true;
+  }
+  return false;
+}
+
+void PassPipeline::Run(Graph& G, callback_type AfterPass) const {
+  for(auto* PI : Passes) {
+    PI->Run(G);
+    if(AfterPass) AfterPass(*PI);
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef GROSS_DRIVER_PASSPIPELINE_H
+#define GROSS_DRIVER_PASSPIPELINE_H
+#include "gross/Graph/Graph.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace gross {
+/// Middle-end passes that can be composed into a pipeline
+/// from command line
+struct PassRegistry {
+  struct PassInfo {
+    const char* Name;
+    const char* Description;
+    // required by later lowering, can not be dropped
+    // from the pipeline
+    bool IsRequired;
+    void (*Run)(Graph&);
+  };
+
+  static const std::vector<PassInfo>& passes();
+  // nullptr if not found
+  static const PassInfo* Find(const std::string& Name);
+};
+
+class PassPipeline {
+  std::vector<const PassRegistry::PassInfo*> Passes;
+
+public:
+  static constexpr unsigned MaxOptLevel = 2;
+  // textual pipeline of -O0 ~ -O2. -O1 is the driver default and
+  // stays at mem2reg,memory-legalize,peephole-cse; new passes only
+  // join -O2
+  static const char* GetPreset(unsigned OptLevel);
+
+  // parse comma separated pass names. Print error message
+  // and return false if there is any unknown pass, or
+  // required passes are missing, duplicated or not
+  // running first in the order they are registered
+  bool Parse(const std::string& Pipeline);
+
+  bool contains(const char* Name) const;
+
+  using callback_type = std::function<void(const PassRegistry::PassInfo&)>;
+  // AfterPass is called after each pass finished
+  void Run(Graph& G, callback_type AfterPass = nullptr) const;
+};
+} // end namespace gross
+#endif
@@ -5,6 +5,7 @@ using namespace gross;
 
 // will clear the Attrs buffer in the current builder
 void AttributeBuilder::Attach(Node* N) {
+  assert(!G.IsConcurrentBuild() && "Attributes are not thread-safe");
   auto& AttrList = G.Attributes[N];
   AttrList.splice(AttrList.end(), std::move(Attrs));
   AttrSet.clear();
@@ -2,6 +2,8 @@
 #include "boost/concept/assert.hpp"
 #include "gross/Graph/Graph.h"
 #include "gross/Graph/BGL.h"
+#include "gross/Graph/NodeUtils.h"
+#include "boost/graph/depth_first_search.hpp"
 #include "boost/graph/graph_concepts.hpp"
 
 TEST(GraphBGLUnitTest, TestGraphConcept) {
@@ -43,3 +45,53 @@ TEST(SubGraphBGLUnitTest, TestVertexReadablePropertyMapConcept) {
                                               boost::vertex_index_t>,
                           gross::Node* > ));
 }
+
+TEST(SubGraphBGLUnitTest, TestVertexIndex) {
+  using namespace gross;
+  Graph G;
+  auto* C1 = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* C2 = NodeBuilder<IrOpcode::ConstantInt>(&G, 2).Build();
+  auto* Add = new (G) Node(IrOpcode::BinAdd, {C1, C2});
+  G.InsertNode(Add);
+  // not part of the SubGraph
+  (void) NodeBuilder<IrOpcode::ConstantInt>(&G, 3).Build();
+  auto* Tail = new (G) Node(IrOpcode::BinMul, {Add, C1});
+  G.InsertNode(Tail);
+
+  SubGraph SG(Tail);
+  auto IdxMap = boost::get(boost::vertex_index, SG);
+  std::vector<bool> Seen(boost::num_vertices(SG), false);
+  for(auto* N : SG.nodes()) {
+    auto Idx = boost::get(IdxMap, N);
+    ASSERT_LT(Idx, Seen.size());
+    EXPECT_FALSE(Seen[Idx]);
+    Seen[Idx] = true;
+  }
+
+  // vertex index of Graph is compacted after node removal
+  G.RemoveNode(G.node_begin() + 3);
+  auto GIdxMap = boost::get(boost::vertex_index, G);
+  EXPECT_EQ(boost::get(GIdxMap, Tail), 3);
+
+  // use the default (vector-backed) color map
+  size_t NumFinished = 0;
+  struct Visitor : public boost::default_dfs_visitor {
+    size_t& Counter;
+    explicit Visitor(size_t& C) : Counter(C) {}
+    void finish_vertex(Node*, const SubGraph&) { ++Counter; }
+  };
+  boost::depth_first_search(SG, boost::visitor(Visitor(NumFinished)));
+  EXPECT_EQ(NumFinished, 4);
+}
+
+namespace {
+struct IdentityPatcher {
+  gross::Use operator()(const gross::Use& E) const { return E; }
+};
+} // end anonymous namespace
+TEST(PatchedSubGraphBGLUnitTest, TestGraphConcepts) {
+  using PatchedGraph = gross::PatchedSubGraph<IdentityPatcher>;
+  BOOST_CONCEPT_ASSERT(( boost::GraphConcept<PatchedGraph> ));
+  BOOST_CONCEPT_ASSERT(( boost::VertexListGraphConcept<PatchedGraph> ));
+  BOOST_CONCEPT_ASSERT(( boost::IncidenceGraphConcept<PatchedGraph> ));
+}
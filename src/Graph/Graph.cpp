@@ -3,7 +3,10 @@
 #include "gross/Graph/NodeUtils.h"
 #include "gross/Graph/NodeMarker.h"
 #include "boost/graph/graphviz.hpp"
+#include "boost/functional/hash.hpp"
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iterator>
 
 using namespace gross;
@@ -22,7 +25,221 @@ SubGraph::edge_iterator SubGraph::edge_end() {
 size_t SubGraph::edge_size() { return std::distance(edge_begin(),
                                                     edge_end()); }
 
+struct Graph::FunctionBuildState {
+  Graph* Owner;
+  SpecificBumpAllocator<Node>* Allocator;
+  // nodes created in this function, as well as the pooled
+  // nodes created during the concurrent build that are used here
+  std::vector<Node*> Nodes;
+  // overlay on Graph::ValueNumbers, nullptr if the entry is erased
+  ValueNumberMap ValueNumbers;
+
+  explicit FunctionBuildState(Graph* G)
+    : Owner(G), Allocator(nullptr) {}
+};
+
+struct Graph::ConcurrentBuildState {
+  uint32_t FirstNodeId;
+  // provisional node ids
+  std::atomic<uint32_t> NextNodeId;
+  std::vector<FunctionBuildState> Functions;
+
+  ConcurrentBuildState(Graph* G, size_t NumFunctions)
+    : FirstNodeId(G->NextNodeId),
+      NextNodeId(G->NextNodeId),
+      Functions(NumFunctions, FunctionBuildState(G)) {}
+};
+
+thread_local Graph::FunctionBuildState* Graph::CurrentBuild = nullptr;
+constexpr uint32_t Graph::NoOwner;
+constexpr uint32_t Graph::SharedOwner;
+
+Graph::Graph()
+  : NextNodeId(0U),
+    NodeIndicesValid(false),
+    DeadNode(nullptr),
+    ValueNumbering(false),
+    SharedNodesDetached(false),
+    FunctionLocal(false),
+    MarkerMax(),
+    NumActiveMarkers(),
+    NodeIdxMarker(nullptr),
+    NodeIdxCounter(0U) {}
+
+Graph::~Graph() = default;
+
+Graph::FunctionBuildState* Graph::getCurrentBuild() const {
+  return CurrentBuild && CurrentBuild->Owner == this? CurrentBuild : nullptr;
+}
+
+void Graph::UsePooledNode(Node* N) {
+  if(auto* FB = getCurrentBuild())
+    if(N->getId() >= ConcurrentBuild->FirstNodeId)
+      FB->Nodes.push_back(N);
+}
+
+void Graph::BeginConcurrentBuild(size_t NumFunctions, size_t NumThreads) {
+  assert(!ConcurrentBuild && "Already building concurrently");
+  assert(!NodeIdxMarker && "Node indices can't be tracked concurrently");
+  ConcurrentBuild.reset(new ConcurrentBuildState(this, NumFunctions));
+  while(ThreadAllocators.size() < NumThreads)
+    ThreadAllocators.emplace_back(new SpecificBumpAllocator<Node>());
+}
+
+void Graph::EndConcurrentBuild() {
+  assert(ConcurrentBuild && "Not building concurrently");
+  auto& CB = *ConcurrentBuild;
+  // place the nodes in the order they would have been
+  // created if functions were built one after another
+  std::vector<bool> Placed(CB.NextNodeId - CB.FirstNodeId, false);
+  for(auto& FB : CB.Functions) {
+    for(auto* N : FB.Nodes) {
+      auto Idx = N->Id - CB.FirstNodeId;
+      if(Placed[Idx]) continue;
+      Placed[Idx] = true;
+      N->Id = NextNodeId++;
+      Nodes.emplace_back(N);
+      if(NodeIndicesValid)
+        NodeIndices[N] = Nodes.size() - 1;
+    }
+    for(auto& VN : FB.ValueNumbers) {
+      if(VN.second)
+        ValueNumbers[VN.first] = VN.second;
+      else
+        ValueNumbers.erase(VN.first);
+    }
+  }
+  assert(NextNodeId == CB.NextNodeId && "Some nodes are not placed");
+  ConcurrentBuild.reset();
+  // caches are indexed by node id
+  InvalidateSubRegions();
+}
+
+Graph::BuildScope::BuildScope(Graph& G, size_t FunctionIdx,
+                              size_t ThreadIdx)
+  : PrevBuild(CurrentBuild) {
+  assert(G.ConcurrentBuild && "Not building concurrently");
+  auto& FB = G.ConcurrentBuild->Functions.at(FunctionIdx);
+  FB.Allocator = G.ThreadAllocators.at(ThreadIdx).get();
+  CurrentBuild = &FB;
+}
+Graph::BuildScope::~BuildScope() {
+  CurrentBuild = PrevBuild;
+}
+
+bool Graph::IsSharedNode(const Node* N) const {
+  if(N->IsSharedNode) return true;
+  switch(N->getOp()) {
+  case IrOpcode::ConstantInt:
+  case IrOpcode::ConstantStr:
+  case IrOpcode::FunctionStub:
+  case IrOpcode::Dead:
+    return true;
+  default:
+    return GlobalVariables.count(const_cast<Node*>(N));
+  }
+}
+
+std::vector<uint32_t> Graph::computeOwners() {
+  std::vector<uint32_t> Owners(NextNodeId, NoOwner);
+  std::vector<Node*> Worklist;
+  auto markShared = [&](Node* N) {
+    auto& Owner = Owners[N->getId()];
+    if(Owner == SharedOwner) return;
+    Owner = SharedOwner;
+    Worklist.push_back(N);
+  };
+  // inputs of shared nodes are shared as well
+  auto propagate = [&]() {
+    while(!Worklist.empty()) {
+      auto* N = Worklist.back();
+      Worklist.pop_back();
+      for(auto* Input : N->inputs())
+        markShared(Input);
+    }
+  };
+
+  for(auto* N : Nodes)
+    if(IsSharedNode(N)) markShared(N);
+  propagate();
+  uint32_t FuncIdx = 0U;
+  for(auto& SG : SubRegions) {
+    for(auto* N : SG.nodes()) {
+      auto& Owner = Owners[N->getId()];
+      if(Owner == NoOwner)
+        Owner = FuncIdx;
+      else if(Owner != FuncIdx)
+        markShared(N);
+    }
+    propagate();
+    ++FuncIdx;
+  }
+  return Owners;
+}
+
+std::vector<Node*> Graph::getCrossFunctionRoots() {
+  auto Owners = computeOwners();
+  auto isCrossFunction = [&,this](Node* N) -> bool {
+    return Owners[N->getId()] == SharedOwner && !IsSharedNode(N);
+  };
+  std::vector<Node*> Roots;
+  for(auto* N : Nodes) {
+    if(!isCrossFunction(N)) continue;
+    auto Users = N->users();
+    if(std::none_of(Users.begin(), Users.end(), isCrossFunction))
+      Roots.push_back(N);
+  }
+  // node lists will be stale once these nodes are modified
+  InvalidateSubRegions();
+  return Roots;
+}
+
+bool Graph::DetachSharedNodes() {
+  assert(!SharedNodesDetached && "Shared nodes are already detached");
+  auto Owners = computeOwners();
+  // unreachable nodes are still modified when their inputs are
+  // replaced, so they can't use nodes from different functions either
+  for(auto* N : Nodes) {
+    if(Owners[N->getId()] != NoOwner) continue;
+    uint32_t Owner = NoOwner;
+    for(auto* Input : N->inputs()) {
+      auto InputOwner = Owners[Input->getId()];
+      if(InputOwner == NoOwner || InputOwner == SharedOwner) continue;
+      if(Owner != NoOwner && Owner != InputOwner) {
+        InvalidateSubRegions();
+        return false;
+      }
+      Owner = InputOwner;
+    }
+  }
+
+  for(auto* N : Nodes) {
+    if(Owners[N->getId()] != SharedOwner) continue;
+    N->IsSharedNode = true;
+    for(auto& KindUsers : N->Users) {
+      for(auto& E : KindUsers)
+        E.User->InputUseIdx[E.InputIdx] = Node::DetachedUseIdx;
+      KindUsers.clear();
+    }
+  }
+  SharedNodesDetached = true;
+  return true;
+}
+
+void Graph::AttachSharedNodes() {
+  assert(SharedNodesDetached && "Shared nodes are not detached");
+  assert(!ConcurrentBuild && "Still building concurrently");
+  for(auto* N : Nodes)
+    N->IsSharedNode = false;
+  for(auto* N : Nodes)
+    for(uint32_t i = 0U, E = N->Inputs.size(); i < E; ++i)
+      if(N->InputUseIdx[i] == Node::DetachedUseIdx)
+        N->linkInputUse(i);
+  SharedNodesDetached = false;
+}
+
 void Graph::MarkGlobalVar(Node* N) {
+  assert(!SharedNodesDetached && "Can't add global variables now");
   assert(N->getOp() == IrOpcode::SrcVarDecl ||
          N->getOp() == IrOpcode::SrcArrayDecl ||
          N->getOp() == IrOpcode::Alloca);
@@ -36,26 +253,201 @@ void Graph::ReplaceGlobalVar(Node* Old, Node* New) {
   }
 }
 
+void* Node::operator new(size_t Size, Graph& G) {
+  assert(Size == sizeof(Node));
+  if(auto* FB = G.getCurrentBuild())
+    return FB->Allocator->Allocate();
+  return G.NodeAllocator.Allocate();
+}
+void Node::operator delete(void* Ptr, Graph& G) {
+  if(auto* FB = G.getCurrentBuild())
+    FB->Allocator->Deallocate(Ptr);
+  else
+    G.NodeAllocator.Deallocate(Ptr);
+}
+
 void Graph::InsertNode(Node* N) {
-  Nodes.emplace_back(N);
-  if(NodeIdxMarker)
-    NodeIdxMarker->Set(N, NodeIdxCounter++);
+  assert(!N->hasId() && "Node has already been inserted");
+  if(auto* FB = getCurrentBuild()) {
+    // final id will be assigned in EndConcurrentBuild
+    N->Id = ConcurrentBuild->NextNodeId++;
+    FB->Nodes.push_back(N);
+  } else {
+    assert(!ConcurrentBuild && "Building node outside BuildScope");
+    N->Id = NextNodeId++;
+    Nodes.emplace_back(N);
+    if(NodeIndicesValid)
+      NodeIndices[N] = Nodes.size() - 1;
+    if(NodeIdxMarker)
+      NodeIdxMarker->Set(N, NodeIdxCounter++);
+  }
+  if(SharedNodesDetached && IsSharedNode(N))
+    N->IsSharedNode = true;
 }
 
 typename Graph::node_iterator
 Graph::RemoveNode(typename Graph::node_iterator NI) {
-  auto* N = NI->get();
+  auto* N = *NI;
   if(!N->IsDead()) {
+    // building Dead node might invalidate the iterator
+    auto Idx = std::distance(Nodes.begin(), NI);
     auto* DeadNode = NodeBuilder<IrOpcode::Dead>(this).Build();
     N->Kill(DeadNode);
+    NI = Nodes.begin() + Idx;
   }
   // unlink it with DeadNode
   N->removeValueInputAll(DeadNode);
   N->removeEffectInputAll(DeadNode);
   N->removeControlInputAll(DeadNode);
+  // release out-of-line edge storage, the node itself
+  // will be freed along with the Graph
+  N->Inputs.shrink_to_fit();
+  N->InputUseIdx.shrink_to_fit();
+  for(auto& KindUsers : N->Users)
+    KindUsers.shrink_to_fit();
+  NodeIndicesValid = false;
   return Nodes.erase(NI);
 }
 
+size_t Graph::RemoveNodes(const NodeSet& Marked) {
+  assert(!DeadNode || !Marked.count(DeadNode));
+  auto isSwept = [&Marked,this](Node* N) -> bool {
+    return N == DeadNode || Marked.count(N);
+  };
+  auto isAny = [](Node*) { return true; };
+  for(auto* N : Nodes) {
+    if(Marked.count(N))
+      N->removeInputsIf(isAny);
+    else
+      N->removeInputsIf(isSwept);
+  }
+
+  auto NewEnd = std::remove_if(Nodes.begin(), Nodes.end(),
+                               [&Marked](Node* N) -> bool {
+    if(!Marked.count(N)) return false;
+    assert(!N->user_size() && "Removed node still has users");
+    N->IsKilled = true;
+    // release out-of-line edge storage
+    N->Inputs.shrink_to_fit();
+    N->InputUseIdx.shrink_to_fit();
+    for(auto& KindUsers : N->Users)
+      KindUsers.shrink_to_fit();
+    return true;
+  });
+  size_t NumRemoved = std::distance(NewEnd, Nodes.end());
+  Nodes.erase(NewEnd, Nodes.end());
+  if(NumRemoved) NodeIndicesValid = false;
+  return NumRemoved;
+}
+
+size_t Graph::ValueNumberKeyHash::operator()(const ValueNumberKey& Key)
+  const {
+  size_t Seed = std::hash<unsigned>{}(static_cast<unsigned>(Key.Op));
+  boost::hash_combine(Seed, std::hash<Node*>{}(Key.LHS));
+  boost::hash_combine(Seed, std::hash<Node*>{}(Key.RHS));
+  return Seed;
+}
+
+bool Graph::MakeValueNumberKey(IrOpcode::ID Op, Node* LHS, Node* RHS,
+                               ValueNumberKey& Key) const {
+  if(!LHS || !RHS) return false;
+  switch(Op) {
+#define COMMON_OP(OC) \
+  case IrOpcode::OC:
+#include "gross/Graph/Opcodes.def"
+#define DLX_ARITH_OP(OC)  \
+  case IrOpcode::DLX##OC: \
+  case IrOpcode::DLX##OC##I:
+#include "gross/Graph/DLXOpcodes.def"
+    break;
+  default:
+    return false;
+  }
+  bool IsCommutative = false;
+  switch(Op) {
+  case IrOpcode::BinAdd:
+  case IrOpcode::BinMul:
+  case IrOpcode::BinEq:
+  case IrOpcode::BinNe:
+  case IrOpcode::DLXAdd:
+  case IrOpcode::DLXMul:
+  case IrOpcode::DLXBitOR:
+  case IrOpcode::DLXBitAND:
+  case IrOpcode::DLXBitXOR:
+    IsCommutative = true;
+    break;
+  default:
+    break;
+  }
+  // leave them to constant folding. Also prevent nodes from
+  // being shared across functions, since constants are global
+  if(LHS->getOp() == IrOpcode::ConstantInt &&
+     RHS->getOp() == IrOpcode::ConstantInt)
+    return false;
+  // same for other shared nodes while functions are
+  // modified independently
+  if((SharedNodesDetached || FunctionLocal) &&
+     IsSharedNode(LHS) && IsSharedNode(RHS))
+    return false;
+  if(IsCommutative && std::less<Node*>{}(RHS, LHS))
+    std::swap(LHS, RHS);
+  Key = ValueNumberKey{Op, LHS, RHS};
+  return true;
+}
+
+Node* Graph::FindValueNumber(IrOpcode::ID Op, Node* LHS, Node* RHS) {
+  ValueNumberKey Key;
+  if(!ValueNumbering || !MakeValueNumberKey(Op, LHS, RHS, Key))
+    return nullptr;
+  // entries of the current function take precedence, and
+  // the global table is read-only while building concurrently
+  auto* FB = getCurrentBuild();
+  Node* N = nullptr;
+  ValueNumberMap::iterator It;
+  if(FB && (It = FB->ValueNumbers.find(Key)) != FB->ValueNumbers.end()) {
+    N = It->second;
+    if(!N) return nullptr;
+  } else {
+    It = ValueNumbers.find(Key);
+    if(It == ValueNumbers.end()) return nullptr;
+    N = It->second;
+  }
+  // validate the entry, since the node might have been
+  // killed or modified after insertion
+  ValueNumberKey CurKey;
+  if(N->IsDead() ||
+     N->getNumValueInput() != 2 ||
+     N->getNumEffectInput() || N->getNumControlInput() ||
+     !MakeValueNumberKey(N->getOp(), N->getValueInput(0),
+                         N->getValueInput(1), CurKey) ||
+     !(CurKey == Key)) {
+    if(FB)
+      FB->ValueNumbers[Key] = nullptr;
+    else
+      ValueNumbers.erase(It);
+    return nullptr;
+  }
+  return N;
+}
+
+Node* Graph::AddValueNumber(Node* N) {
+  if(!ValueNumbering || N->getNumValueInput() != 2 ||
+     N->getNumEffectInput() || N->getNumControlInput())
+    return N;
+  auto* LHS = N->getValueInput(0);
+  auto* RHS = N->getValueInput(1);
+  if(auto* Existing = FindValueNumber(N->getOp(), LHS, RHS))
+    return Existing;
+  ValueNumberKey Key;
+  if(MakeValueNumberKey(N->getOp(), LHS, RHS, Key)) {
+    if(auto* FB = getCurrentBuild())
+      FB->ValueNumbers[Key] = N;
+    else
+      ValueNumbers[Key] = N;
+  }
+  return N;
+}
+
 void Graph::AddSubRegion(const SubGraph& SG) {
   SubRegions.push_back(SG);
 }
@@ -70,6 +462,71 @@ void Graph::dumpGraphviz(std::ostream& OS) {
                         graph_prop_writer{});
 }
 
-size_t SubGraph::node_size() const {
-  return std::distance(node_cbegin(), node_cend());
+size_t Graph::getNodeIndex(const Node* N) const {
+  if(!NodeIndicesValid) {
+    NodeIndices.clear();
+    for(uint32_t i = 0U, Size = Nodes.size(); i < Size; ++i)
+      NodeIndices[Nodes[i]] = i;
+    NodeIndicesValid = true;
+  }
+  return NodeIndices.at(N);
+}
+
+SubGraph::NodeCache& SubGraph::getCache() const {
+  if(!Cache) {
+    static NodeCache EmptyCache;
+    return EmptyCache;
+  }
+  if(Cache->Valid) return *Cache;
+
+  auto& Nodes = Cache->BFSNodes;
+  auto& Indices = Cache->Indices;
+  auto setIndex = [&Indices](Node* N, uint32_t Idx) -> bool {
+    auto Id = N->getId();
+    if(Id >= Indices.size())
+      Indices.resize(std::max<size_t>(Id + 1, Indices.size() * 2), ~0U);
+    if(Indices[Id] != ~0U) return false;
+    Indices[Id] = Idx;
+    return true;
+  };
+  Nodes.clear();
+  Indices.clear();
+  setIndex(TailNode, 0U);
+  Nodes.push_back(TailNode);
+  for(size_t i = 0; i < Nodes.size(); ++i) {
+    for(auto* N : Nodes[i]->inputs()) {
+      if(setIndex(N, Nodes.size()))
+        Nodes.push_back(N);
+    }
+  }
+  Cache->Valid = true;
+  return *Cache;
+}
+
+SubGraph::NodeCache& SubGraph::getPOCache() const {
+  auto& C = getCache();
+  if(!Cache || C.HasPO) return C;
+
+  auto& Nodes = C.PONodes;
+  Nodes.clear();
+  Nodes.reserve(C.BFSNodes.size());
+  // (node, index of next input to visit)
+  std::vector<std::pair<Node*, unsigned>> Stack;
+  NodeSet Visited;
+  Stack.push_back({TailNode, 0U});
+  Visited.insert(TailNode);
+  while(!Stack.empty()) {
+    auto& Top = Stack.back();
+    auto* N = Top.first;
+    if(N->input_begin() + Top.second != N->input_end()) {
+      auto* Input = N->input_begin()[Top.second++];
+      if(Visited.insert(Input))
+        Stack.push_back({Input, 0U});
+    } else {
+      Nodes.push_back(N);
+      Stack.pop_back();
+    }
+  }
+  C.HasPO = true;
+  return C;
 }
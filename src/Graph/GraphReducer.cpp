@@ -3,11 +3,19 @@
 #include "gross/Graph/GraphReducer.h"
 #include "boost/graph/depth_first_search.hpp"
 #include "boost/graph/properties.hpp"
+#include <algorithm>
 #include <vector>
 #include <iostream>
 
 using namespace gross;
 
+static size_t NumJobs = 1U;
+
+void GraphReducer::SetNumJobs(size_t Jobs) {
+  NumJobs = std::max<size_t>(Jobs, 1U);
+}
+size_t GraphReducer::GetNumJobs() { return NumJobs; }
+
 struct GraphReducer::DFSVisitor
   : public boost::default_dfs_visitor {
   DFSVisitor(std::vector<Node*>& Preced,
@@ -17,6 +25,8 @@ struct GraphReducer::DFSVisitor
   }
 
   void finish_vertex(Node* N, const SubGraph& G) {
+    // shared nodes can't be modified when they are detached
+    if(N->IsShared()) return;
     Precedence.push_back(N);
     Marker.Set(N, GraphReducer::ReductionState::OnStack);
   }
@@ -30,7 +40,9 @@ GraphReducer::GraphReducer(Graph& graph, bool TrimGraph)
   : G(graph),
     DeadNode(NodeBuilder<IrOpcode::Dead>(&G).Build()),
     RSMarker(G, 4),
-    DoTrimGraph(TrimGraph) {}
+    DoTrimGraph(TrimGraph),
+    NumReductions(0U), NumRevisits(0U),
+    NumKilled(0U), NumTrimmed(0U) {}
 
 void GraphReducer::Replace(Node* N, Node* Replacement) {
   for(auto* Usr : N->users()) {
@@ -38,128 +50,130 @@ void GraphReducer::Replace(Node* N, Node* Replacement) {
   }
   N->ReplaceWith(Replacement);
   N->Kill(DeadNode);
+  ++NumKilled;
   Recurse(Replacement);
 }
 
 void GraphReducer::Revisit(Node* N) {
+  if(N->IsShared()) return;
   if(RSMarker.Get(N) == ReductionState::Visited) {
     RSMarker.Set(N, ReductionState::Revisit);
-    RevisitStack.insert(RevisitStack.begin(), N);
+    RevisitStack.push_back(N);
+    ++NumRevisits;
   }
 }
 
 void GraphReducer::Push(Node* N) {
   RSMarker.Set(N, ReductionState::OnStack);
-  ReductionStack.insert(ReductionStack.begin(), N);
+  ReductionStack.push_back(N);
 }
 
 void GraphReducer::Pop() {
-  auto* TopNode = ReductionStack.front();
-  ReductionStack.erase(ReductionStack.begin());
+  auto* TopNode = ReductionStack.back();
+  ReductionStack.pop_back();
   RSMarker.Set(TopNode, ReductionState::Visited);
 }
 
 bool GraphReducer::Recurse(Node* N) {
-  if(RSMarker.Get(N) > ReductionState::Revisit) return false;
+  if(N->IsShared() ||
+     RSMarker.Get(N) > ReductionState::Revisit) return false;
   Push(N);
   return true;
 }
 
 void GraphReducer::DFSVisit(SubGraph& SG, NodeMarker<ReductionState>& Marker) {
   DFSVisitor Vis(ReductionStack, Marker);
-  std::unordered_map<Node*,boost::default_color_type> ColorStorage;
-  StubColorMap<decltype(ColorStorage), Node> ColorMap(ColorStorage);
-  boost::depth_first_search(SG, Vis, std::move(ColorMap));
+  std::vector<boost::default_color_type> ColorStorage(boost::num_vertices(SG));
+  auto ColorMap
+    = boost::make_iterator_property_map(ColorStorage.begin(),
+                                        boost::get(boost::vertex_index, SG));
+  boost::depth_first_search(SG, Vis, ColorMap);
+  // top of the stack is at the back, so that
+  // the first finished node is visited first
+  std::reverse(ReductionStack.begin(), ReductionStack.end());
 }
 
-void GraphReducer::runOnFunctionGraph(SubGraph& SG,
-                                      _detail::ReducerConcept* Reducer) {
-  DFSVisit(SG, RSMarker);
-
-  while(!ReductionStack.empty() || !RevisitStack.empty()) {
-    while(!ReductionStack.empty()) {
-      Node* N = ReductionStack.front();
-      if(N->getOp() == IrOpcode::Dead) {
-        Pop();
-        continue;
-      }
-
-      auto RP = Reducer->Reduce(N);
-
-      if(!RP.Changed()) {
-        Pop();
-        continue;
-      }
-
-      if(RP.Replacement() == N) {
-        // in-place replacement, recurse on input
-        bool IsRecursed = false;
-        for(auto* Input : N->inputs()) {
-          if(Input != N)
-            IsRecursed |= Recurse(Input);
-        }
-        if(IsRecursed) continue;
-      }
-
-      Pop();
-
-      if(RP.Replacement() != N) {
-        Replace(N, RP.Replacement());
-      } else {
-        // revisit all the users
-        for(auto* Usr : N->users()) {
-          if(Usr != N) Revisit(Usr);
-        }
-      }
+void GraphReducer::ApplyReduction(Node* N, const GraphReduction& RP) {
+  if(!RP.Changed()) {
+    Pop();
+    return;
+  }
+  ++NumReductions;
+
+  if(RP.Replacement() == N) {
+    // in-place replacement, recurse on input
+    bool IsRecursed = false;
+    for(auto* Input : N->inputs()) {
+      if(Input != N)
+        IsRecursed |= Recurse(Input);
     }
+    if(IsRecursed) return;
+  }
 
-    while(!RevisitStack.empty()) {
-      Node* N = RevisitStack.front();
-      RevisitStack.erase(RevisitStack.begin());
+  Pop();
 
-      if(RSMarker.Get(N) == ReductionState::Revisit) {
-        Push(N);
-      }
+  if(RP.Replacement() != N) {
+    Replace(N, RP.Replacement());
+  } else {
+    // revisit all the users
+    for(auto* Usr : N->users()) {
+      if(Usr != N) Revisit(Usr);
     }
   }
 }
 
-void GraphReducer::runImpl(_detail::ReducerConcept* Reducer) {
-  for(auto& SG : G.subregions())
-    runOnFunctionGraph(SG, Reducer);
+void GraphReducer::FlushRevisitStack() {
+  while(!RevisitStack.empty()) {
+    Node* N = RevisitStack.back();
+    RevisitStack.pop_back();
 
-  if(DoTrimGraph) {
-    // remove nodes that are unreachable from any function
-    NodeMarker<ReductionState> TrimMarker(G, 4);
-    for(auto& SG : G.subregions()) {
-      DFSVisit(SG, TrimMarker);
-    }
-    for(auto NI = G.node_begin(); NI != G.node_end();) {
-      auto* N = Graph::GetNodeFromIt(NI);
-      if(TrimMarker.Get(N) == ReductionState::Unvisited &&
-         !NodeProperties<IrOpcode::VirtGlobalValues>(N) &&
-         !G.IsGlobalVar(N)) {
-        NI = G.RemoveNode(NI);
-      } else {
-        ++NI;
-      }
+    if(RSMarker.Get(N) == ReductionState::Revisit) {
+      Push(N);
     }
+  }
+}
 
-    // remove all deps to Dead node
-    auto* DeadNode = NodeBuilder<IrOpcode::Dead>(&G).Build();
-    std::vector<Node*> DeadUsrs;
-    DeadUsrs.assign(DeadNode->value_users().begin(),
-                    DeadNode->value_users().end());
-    for(auto* N : DeadUsrs)
-      N->removeValueInputAll(DeadNode);
-    DeadUsrs.assign(DeadNode->effect_users().begin(),
-                    DeadNode->effect_users().end());
-    for(auto* N : DeadUsrs)
-      N->removeEffectInputAll(DeadNode);
-    DeadUsrs.assign(DeadNode->control_users().begin(),
-                    DeadNode->control_users().end());
-    for(auto* N : DeadUsrs)
-      N->removeEffectInputAll(DeadNode);
+void GraphReducer::TrimGraph() {
+  NodeMarker<ReductionState> TrimMarker(G, 4);
+  for(auto& SG : G.subregions()) {
+    DFSVisit(SG, TrimMarker);
+  }
+  // global variables are always kept, so do their sizes.
+  // Even if no function references them anymore
+  std::vector<Node*> Worklist(G.global_var_begin(), G.global_var_end());
+  while(!Worklist.empty()) {
+    auto* N = Worklist.back();
+    Worklist.pop_back();
+    for(auto* Input : N->inputs()) {
+      if(TrimMarker.Get(Input) != ReductionState::Unvisited) continue;
+      TrimMarker.Set(Input, ReductionState::Visited);
+      Worklist.push_back(Input);
+    }
+  }
+  // and drop all deps to Dead node along the way
+  NumTrimmed += G.SweepNodes([&TrimMarker,this](Node* N) -> bool {
+    return TrimMarker.Get(N) == ReductionState::Unvisited &&
+           !NodeProperties<IrOpcode::VirtGlobalValues>(N) &&
+           !G.IsGlobalVar(N);
+  });
+  G.InvalidateSubRegions();
+}
 
+std::string GraphReducer::getFunctionName(const SubGraph& SG) const {
+  if(auto* End = SG.getTail()) {
+    for(auto* N : End->inputs()) {
+      if(N->getOp() == IrOpcode::Start)
+        return NodeProperties<IrOpcode::Start>(N).name(G);
+    }
   }
+  return "<unknown>";
+}
+
+void GraphReducer::ReportStats(const char* Name, size_t NumCreated) const {
+  auto& Stats = Statistics::Get();
+  Stats.AddCounter(Name, "nodes-created", NumCreated);
+  Stats.AddCounter(Name, "reductions", NumReductions);
+  Stats.AddCounter(Name, "revisits", NumRevisits);
+  Stats.AddCounter(Name, "nodes-killed", NumKilled);
+  Stats.AddCounter(Name, "nodes-trimmed", NumTrimmed);
 }
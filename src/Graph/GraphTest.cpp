@@ -1,5 +1,8 @@
 #include "gross/Graph/Graph.h"
 #include "gross/Graph/GraphReducer.h"
+#include "gross/Graph/NodeMarker.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gross/Support/Statistics.h"
 #include "gtest/gtest.h"
 #include <sstream>
 
@@ -41,3 +44,331 @@ TEST(GraphUnitTest, TestGraphReducerConcept) {
 
   GraphReducer::RunWithEditor<DummyAdvanceReducer>(G);
 }
+
+TEST(GraphUnitTest, TestNodeAllocation) {
+  Graph G;
+  auto* N1 = new (G) Node(IrOpcode::Start, {});
+  G.InsertNode(N1);
+  auto* N2 = new (G) Node(IrOpcode::End, {});
+  G.InsertNode(N2);
+  // nodes are placed contiguously
+  EXPECT_EQ(N1 + 1, N2);
+  EXPECT_EQ(G.node_size(), 2);
+
+  // removing node doesn't affect other nodes' storage
+  G.RemoveNode(G.node_begin() + 1);
+  EXPECT_EQ(G.getNode(0), N1);
+  EXPECT_EQ(N1->getOp(), IrOpcode::Start);
+}
+
+TEST(GraphUnitTest, TestHighFanOutReplacement) {
+  Graph G;
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* One = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* Two = NodeBuilder<IrOpcode::ConstantInt>(&G, 2).Build();
+
+  // should be linear to the number of users
+  const size_t NumUsers = 100000;
+  std::vector<Node*> Adds;
+  for(auto i = 0U; i < NumUsers; ++i) {
+    Adds.push_back(NodeBuilder<IrOpcode::BinAdd>(&G)
+                   .LHS(Zero).RHS(i % 2? One : Zero)
+                   .Build());
+  }
+  EXPECT_EQ(Zero->user_size(), NumUsers + NumUsers / 2);
+  EXPECT_EQ(One->user_size(), NumUsers / 2);
+
+  Zero->ReplaceWith(Two, Use::K_VALUE);
+  EXPECT_EQ(Zero->user_size(), 0);
+  EXPECT_EQ(Two->user_size(), NumUsers + NumUsers / 2);
+  for(auto* N : Adds) {
+    ASSERT_EQ(N->getValueInput(0), Two);
+  }
+
+  // unlink edges one by one
+  for(auto* N : Adds) {
+    N->removeValueInputAll(Two);
+  }
+  EXPECT_EQ(Two->user_size(), 0);
+  EXPECT_EQ(One->user_size(), NumUsers / 2);
+  for(auto i = 0U; i < NumUsers; ++i) {
+    auto* N = Adds[i];
+    ASSERT_EQ(N->getNumValueInput(), i % 2? 1 : 0);
+  }
+}
+
+TEST(GraphUnitTest, TestUsersByKind) {
+  Graph G;
+  auto* A = new (G) Node(IrOpcode::Start, {});
+  G.InsertNode(A);
+  auto* M = NodeBuilder<IrOpcode::Merge>(&G)
+            .AddCtrlInput(A)
+            .Build();
+  // A is both value and effect input of PN
+  auto* PN = new (G) Node(IrOpcode::Phi, {A}, {M}, {A});
+  G.InsertNode(PN);
+
+  EXPECT_EQ(A->user_size(), 3);
+  EXPECT_EQ(A->user_size(Use::K_VALUE), 1);
+  EXPECT_EQ(A->user_size(Use::K_CONTROL), 1);
+  EXPECT_EQ(A->user_size(Use::K_EFFECT), 1);
+  EXPECT_EQ(*A->value_users().begin(), PN);
+  EXPECT_EQ(*A->control_users().begin(), M);
+  EXPECT_EQ(*A->effect_users().begin(), PN);
+  EXPECT_EQ(std::distance(M->control_users().begin(),
+                          M->control_users().end()), 1);
+  EXPECT_EQ(M->user_size(Use::K_VALUE), 0);
+
+  PN->removeValueInput(0);
+  EXPECT_EQ(A->user_size(Use::K_VALUE), 0);
+  EXPECT_EQ(A->user_size(Use::K_EFFECT), 1);
+  EXPECT_EQ(PN->getEffectInput(0), A);
+  EXPECT_EQ(PN->getControlInput(0), M);
+}
+
+TEST(GraphUnitTest, TestNodeMap) {
+  Graph G;
+  std::vector<Node*> Nodes;
+  for(int i = 0; i < 10; ++i) {
+    auto* N = NodeBuilder<IrOpcode::ConstantInt>(&G, i).Build();
+    Nodes.push_back(N);
+  }
+  // ids are dense and follow insertion order
+  for(auto i = 0U; i < Nodes.size(); ++i)
+    EXPECT_EQ(Nodes[i]->getId(), i);
+  EXPECT_EQ(G.getNumNodeIds(), 10);
+
+  NodeMap<int> NM;
+  NM[Nodes[7]] = 7;
+  NM[Nodes[2]] = 2;
+  EXPECT_TRUE(NM.insert({Nodes[5], 5}).second);
+  EXPECT_FALSE(NM.insert({Nodes[5], 50}).second);
+  EXPECT_EQ(NM.size(), 3);
+  EXPECT_EQ(NM.count(Nodes[3]), 0);
+  EXPECT_EQ(NM.at(Nodes[5]), 5);
+  // iterate in id order
+  std::vector<int> Vals;
+  for(auto& P : NM) {
+    EXPECT_EQ(P.first, Nodes[P.second]);
+    Vals.push_back(P.second);
+  }
+  EXPECT_EQ(Vals, std::vector<int>({2, 5, 7}));
+  EXPECT_EQ(NM.erase(Nodes[5]), 1);
+  EXPECT_EQ(NM.erase(Nodes[5]), 0);
+  EXPECT_EQ(NM.size(), 2);
+  EXPECT_EQ(NM.find(Nodes[5]), NM.end());
+
+  NodeSet NS;
+  EXPECT_TRUE(NS.insert(Nodes[9]));
+  EXPECT_FALSE(NS.insert(Nodes[9]));
+  EXPECT_EQ(NS.count(Nodes[9]), 1);
+  EXPECT_EQ(NS.count(Nodes[0]), 0);
+  EXPECT_EQ(NS.erase(Nodes[9]), 1);
+  EXPECT_TRUE(NS.empty());
+}
+
+TEST(GraphUnitTest, TestNestedNodeMarkers) {
+  Graph G;
+  auto* N1 = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* N2 = NodeBuilder<IrOpcode::ConstantInt>(&G, 2).Build();
+
+  NodeMarker<uint8_t> M1(G, 3);
+  M1.Set(N1, 2);
+  {
+    NodeMarker<uint8_t> M2(G, 5);
+    EXPECT_NE(M1.getSlot(), M2.getSlot());
+    EXPECT_EQ(M2.Get(N1), 0);
+    M2.Set(N1, 4);
+    M2.Set(N2, 1);
+    // M1 is not affected
+    EXPECT_EQ(M1.Get(N1), 2);
+    EXPECT_EQ(M1.Get(N2), 0);
+    EXPECT_EQ(M2.Get(N1), 4);
+
+    M2.Reset();
+    EXPECT_EQ(M2.Get(N1), 0);
+    EXPECT_EQ(M2.Get(N2), 0);
+    EXPECT_EQ(M1.Get(N1), 2);
+  }
+  // slot of M2 is released
+  NodeMarker<uint8_t> M3(G, 2);
+  EXPECT_NE(M1.getSlot(), M3.getSlot());
+  EXPECT_EQ(M3.Get(N1), 0);
+}
+
+TEST(GraphUnitTest, TestSweepNodes) {
+  Graph G;
+  auto* Dead = NodeBuilder<IrOpcode::Dead>(&G).Build();
+  auto* C1 = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* C2 = NodeBuilder<IrOpcode::ConstantInt>(&G, 2).Build();
+  std::vector<Node*> Garbage;
+  for(int i = 0; i < 100; ++i) {
+    auto* N = new (G) Node(IrOpcode::BinAdd, {C1, C2});
+    G.InsertNode(N);
+    Garbage.push_back(N);
+  }
+  // chained garbage
+  auto* Sum = new (G) Node(IrOpcode::BinAdd, {Garbage[0], Garbage[1]});
+  G.InsertNode(Sum);
+  Garbage.push_back(Sum);
+  // survivor that uses both garbage and Dead node
+  auto* Keep = new (G) Node(IrOpcode::BinSub, {C1, Sum, Dead, C2});
+  G.InsertNode(Keep);
+
+  auto NumRemoved = G.SweepNodes([](Node* N) -> bool {
+    return N->getOp() == IrOpcode::BinAdd;
+  });
+  EXPECT_EQ(NumRemoved, Garbage.size());
+  EXPECT_EQ(G.node_size(), 4);
+  for(auto* N : Garbage)
+    EXPECT_TRUE(N->IsDead());
+
+  EXPECT_EQ(Keep->getNumValueInput(), 2);
+  EXPECT_EQ(Keep->getValueInput(0), C1);
+  EXPECT_EQ(Keep->getValueInput(1), C2);
+  EXPECT_EQ(C1->user_size(), 1);
+  EXPECT_EQ(C2->user_size(), 1);
+  EXPECT_EQ(Dead->user_size(), 0);
+}
+
+TEST(GraphUnitTest, TestSubGraphNodeCache) {
+  Graph G;
+  auto* C1 = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* C2 = NodeBuilder<IrOpcode::ConstantInt>(&G, 2).Build();
+  auto* Add = new (G) Node(IrOpcode::BinAdd, {C1, C2});
+  G.InsertNode(Add);
+  auto* Tail = new (G) Node(IrOpcode::BinMul, {Add, C1});
+  G.InsertNode(Tail);
+
+  SubGraph SG(Tail);
+  // a copy shares the same cache
+  SubGraph SGCopy(SG);
+  EXPECT_EQ(SG.node_size(), 4);
+  EXPECT_EQ(std::vector<Node*>(SG.node_begin(), SG.node_end()),
+            std::vector<Node*>({Tail, Add, C1, C2}));
+  EXPECT_EQ(std::vector<Node*>(SG.po_begin(), SG.po_end()),
+            std::vector<Node*>({C1, C2, Add, Tail}));
+  EXPECT_EQ(*SG.rpo_begin(), Tail);
+
+  auto* C3 = NodeBuilder<IrOpcode::ConstantInt>(&G, 3).Build();
+  Tail->appendValueInput(C3);
+  // still stale before invalidation
+  EXPECT_EQ(SG.node_size(), 4);
+  SGCopy.InvalidateNodes();
+  EXPECT_EQ(SG.node_size(), 5);
+  EXPECT_EQ(SG.po_nodes().begin()[3], C3);
+}
+
+TEST(GraphUnitTest, TestGraphReducerScaling) {
+  // fold chains of '+ 0' with increasing length. The number of
+  // reductions should grow linearly with the number of nodes.
+  // Running time is measured by ReducerScalingTest in
+  // integration_test instead, since it's too noisy to assert on
+  struct AddZeroReducer {
+    AddZeroReducer(Node* Zero, size_t* Counter)
+      : ZeroNode(Zero), NumReduce(Counter) {}
+
+    GraphReduction Reduce(Node* N) {
+      ++*NumReduce;
+      if(N->getOp() != IrOpcode::BinAdd) return GraphReduction();
+      if(N->getValueInput(1) == ZeroNode)
+        return GraphReduction(N->getValueInput(0));
+      return GraphReduction();
+    }
+
+    static constexpr
+    const char* name() { return "add-zero-reducer"; }
+
+  private:
+    Node* ZeroNode;
+    size_t* NumReduce;
+  };
+
+  for(size_t Length : {2000U, 64000U}) {
+    Graph G;
+    auto* Base = NodeBuilder<IrOpcode::ConstantInt>(&G, 7).Build();
+    auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+    Node* Chain = Base;
+    for(size_t i = 0; i < Length; ++i) {
+      Chain = new (G) Node(IrOpcode::BinAdd, {Chain, Zero});
+      G.InsertNode(Chain);
+    }
+    auto* Tail = new (G) Node(IrOpcode::BinMul, {Chain, Base});
+    G.InsertNode(Tail);
+    G.AddSubRegion(SubGraph(Tail));
+
+    size_t NumReduce = 0;
+    GraphReducer::Run<AddZeroReducer>(G, Zero, &NumReduce);
+    EXPECT_EQ(Tail->getValueInput(0), Base);
+    EXPECT_LE(NumReduce, 4 * (Length + 3)) << "Length: " << Length;
+  }
+}
+
+TEST(GraphUnitTest, TestGraphReducerStatistics) {
+  Graph G;
+  auto* C1 = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* Add = new (G) Node(IrOpcode::BinAdd, {C1, Zero});
+  G.InsertNode(Add);
+  auto* Tail = new (G) Node(IrOpcode::BinMul, {Add, C1});
+  G.InsertNode(Tail);
+  G.AddSubRegion(SubGraph(Tail));
+
+  struct FoldAddReducer {
+    GraphReduction Reduce(Node* N) {
+      if(N->getOp() == IrOpcode::BinAdd)
+        return GraphReduction(N->getValueInput(0));
+      return GraphReduction();
+    }
+
+    static constexpr
+    const char* name() { return "fold-add"; }
+  };
+
+  auto& Stats = Statistics::Get();
+  Stats.EnableCounter();
+  Stats.EnableTimer();
+  GraphReducer::Run<FoldAddReducer>(G);
+  EXPECT_EQ(Stats.GetCounter("fold-add", "reductions"), 1);
+  EXPECT_EQ(Stats.GetCounter("fold-add", "nodes-killed"), 1);
+  // one for the whole module and one for the function
+  EXPECT_EQ(Stats.timings().size(), 2);
+  std::stringstream SS;
+  Stats.printJSON(SS);
+  EXPECT_NE(SS.str().find("\"fold-add\": {"), std::string::npos);
+  Stats.EnableCounter(false);
+  Stats.EnableTimer(false);
+  Stats.clear();
+}
+
+TEST(GraphUnitTest, TestValueNumbering) {
+  Graph G;
+  auto* A = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* B = NodeBuilder<IrOpcode::Argument>(&G, "b").Build();
+  auto* C1 = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* C2 = NodeBuilder<IrOpcode::ConstantInt>(&G, 2).Build();
+
+  // disabled by default
+  EXPECT_NE(NodeBuilder<IrOpcode::BinAdd>(&G).LHS(A).RHS(B).Build(),
+            NodeBuilder<IrOpcode::BinAdd>(&G).LHS(A).RHS(B).Build());
+
+  G.EnableValueNumbering();
+  auto* Add = NodeBuilder<IrOpcode::BinAdd>(&G).LHS(A).RHS(B).Build();
+  // commutative operands are canonicalized
+  EXPECT_EQ(NodeBuilder<IrOpcode::BinAdd>(&G).LHS(B).RHS(A).Build(), Add);
+  auto* Sub = NodeBuilder<IrOpcode::BinSub>(&G).LHS(A).RHS(B).Build();
+  EXPECT_NE(NodeBuilder<IrOpcode::BinSub>(&G).LHS(B).RHS(A).Build(), Sub);
+  EXPECT_EQ(NodeBuilder<IrOpcode::BinSub>(&G).LHS(A).RHS(B).Build(), Sub);
+  // left to constant folding
+  EXPECT_NE(NodeBuilder<IrOpcode::BinAdd>(&G).LHS(C1).RHS(C2).Build(),
+            NodeBuilder<IrOpcode::BinAdd>(&G).LHS(C1).RHS(C2).Build());
+
+  // stale entries are dropped
+  Add->ReplaceUseOfWith(B, C1, Use::K_VALUE);
+  EXPECT_EQ(G.FindValueNumber(IrOpcode::BinAdd, A, B), nullptr);
+  EXPECT_EQ(G.AddValueNumber(Add), Add);
+  EXPECT_EQ(G.FindValueNumber(IrOpcode::BinAdd, C1, A), Add);
+  auto* Dead = NodeBuilder<IrOpcode::Dead>(&G).Build();
+  Sub->Kill(Dead);
+  EXPECT_EQ(G.FindValueNumber(IrOpcode::BinSub, A, B), nullptr);
+}
@@ -10,29 +10,69 @@ Node::Node(IrOpcode::ID OC,
            const std::vector<Node*>& ControlInputs,
            const std::vector<Node*>& EffectInputs)
   : Op(OC),
-    MarkerData(0U),
+    MarkerData(),
+    Id(~0U),
     NumValueInput(ValueInputs.size()),
     NumControlInput(ControlInputs.size()),
     NumEffectInput(EffectInputs.size()),
-    IsKilled(false) {
-  if(NumEffectInput > 0)
-    Inputs.insert(Inputs.begin(),
-                  EffectInputs.begin(), EffectInputs.end());
-  if(NumControlInput > 0)
-    Inputs.insert(Inputs.begin(),
-                  ControlInputs.begin(), ControlInputs.end());
-  if(NumValueInput > 0)
-    Inputs.insert(Inputs.begin(),
-                  ValueInputs.begin(), ValueInputs.end());
+    IsKilled(false),
+    IsSharedNode(false) {
+  Inputs.reserve(NumValueInput + NumControlInput + NumEffectInput);
+  Inputs.append(ValueInputs.begin(), ValueInputs.end());
+  Inputs.append(ControlInputs.begin(), ControlInputs.end());
+  Inputs.append(EffectInputs.begin(), EffectInputs.end());
+  InputUseIdx.resize(Inputs.size());
+  for(unsigned i = 0U, N = Inputs.size(); i < N; ++i)
+    linkInputUse(i);
+}
+
+void Node::linkInputUse(unsigned RawIdx) {
+  if(Inputs[RawIdx]->IsSharedNode) {
+    // will be recorded in Graph::AttachSharedNodes
+    InputUseIdx[RawIdx] = DetachedUseIdx;
+    return;
+  }
+  auto& InputUsers = Inputs[RawIdx]->getUsers(inputUseKind(RawIdx));
+  InputUseIdx[RawIdx] = InputUsers.size();
+  InputUsers.push_back({this, RawIdx});
+}
+
+void Node::unlinkInputUse(unsigned RawIdx) {
+  auto UseIdx = InputUseIdx[RawIdx];
+  if(UseIdx == DetachedUseIdx) return;
+  auto& InputUsers = Inputs[RawIdx]->getUsers(inputUseKind(RawIdx));
+  assert(UseIdx < InputUsers.size() &&
+         InputUsers[UseIdx].User == this &&
+         InputUsers[UseIdx].InputIdx == RawIdx &&
+         "Corrupted use list");
+  // move the last record into the hole
+  const auto& Last = InputUsers.back();
+  Last.User->InputUseIdx[Last.InputIdx] = UseIdx;
+  InputUsers[UseIdx] = Last;
+  InputUsers.pop_back();
+}
+
+void Node::reindexInputUses(unsigned RawIdx) {
+  for(unsigned i = RawIdx, N = Inputs.size(); i < N; ++i) {
+    if(InputUseIdx[i] == DetachedUseIdx) continue;
+    Inputs[i]->getUsers(inputUseKind(i))[InputUseIdx[i]].InputIdx = i;
+  }
+}
+
+void Node::setRawInput(unsigned RawIdx, Node* NewNode) {
+  unlinkInputUse(RawIdx);
+  Inputs[RawIdx] = NewNode;
+  linkInputUse(RawIdx);
 }
 
 void Node::appendNodeInput(unsigned& Size, unsigned Offset,
                            Node* NewNode) {
-  auto It = Inputs.begin();
-  std::advance(It, Size + Offset);
-  Inputs.insert(It, NewNode);
+  auto Idx = Size + Offset;
+  Inputs.insert(Inputs.begin() + Idx, NewNode);
+  InputUseIdx.insert(InputUseIdx.begin() + Idx, 0U);
   Size += 1;
-  NewNode->Users.push_back(this);
+  reindexInputUses(Idx + 1);
+  linkInputUse(Idx);
 }
 
 void Node::setNodeInput(unsigned Index, unsigned Size, unsigned Offset,
@@ -40,20 +80,7 @@ void Node::setNodeInput(unsigned Index, unsigned Size, unsigned Offset,
   Index += Offset;
   Size += Offset;
   assert(Index < Size);
-  Node* OldNode = Inputs[Index];
-  auto It = std::find(OldNode->Users.begin(), OldNode->Users.end(),
-                      this);
-  assert(It != OldNode->Users.end());
-  OldNode->Users.erase(It);
-  Inputs[Index] = NewNode;
-  NewNode->Users.push_back(this);
-}
-
-void Node::cleanupRemoveNodeInput(Node* OldInput) {
-  auto It = std::find(OldInput->Users.begin(), OldInput->Users.end(),
-                      this);
-  assert(It != OldInput->Users.end());
-  OldInput->Users.erase(It);
+  setRawInput(Index, NewNode);
 }
 
 void Node::removeNodeInput(unsigned Index, unsigned& Size, unsigned Offset) {
@@ -61,23 +88,23 @@ void Node::removeNodeInput(unsigned Index, unsigned& Size, unsigned Offset) {
   Index += Offset;
   S += Offset;
   assert(Index < S);
-  Node* OldNode = Inputs[Index];
-  cleanupRemoveNodeInput(OldNode);
+  unlinkInputUse(Index);
   Inputs.erase(Inputs.begin() + Index);
+  InputUseIdx.erase(InputUseIdx.begin() + Index);
   Size -= 1;
+  reindexInputUses(Index);
 }
 
 void Node::removeNodeInputAll(Node* Target, unsigned& Size, unsigned Offset) {
-  auto I = Inputs.begin() + Offset;
-  while(I != (Inputs.begin() + Size + Offset)) {
-    auto* N = *I;
-    if(N == Target) {
-      // remove
-      cleanupRemoveNodeInput(N);
-      I = Inputs.erase(I);
+  for(auto i = Offset; i < Size + Offset;) {
+    if(Inputs[i] == Target) {
+      unlinkInputUse(i);
+      Inputs.erase(Inputs.begin() + i);
+      InputUseIdx.erase(InputUseIdx.begin() + i);
       --Size;
+      reindexInputUses(i);
     } else {
-      ++I;
+      ++i;
     }
   }
 }
@@ -139,28 +166,6 @@ void Node::Kill(Node* DeadNode) {
   IsKilled = true;
 }
 
-llvm::iterator_range<Node::value_user_iterator>
-Node::value_users() {
-  is_value_use Pred(this);
-  value_user_iterator it_begin(Pred, Users.begin(), Users.end()),
-                      it_end(Pred, Users.end(), Users.end());
-  return llvm::make_range(it_begin, it_end);
-}
-llvm::iterator_range<Node::control_user_iterator>
-Node::control_users() {
-  is_control_use Pred(this);
-  control_user_iterator it_begin(Pred, Users.begin(), Users.end()),
-                        it_end(Pred, Users.end(), Users.end());
-  return llvm::make_range(it_begin, it_end);
-}
-llvm::iterator_range<Node::effect_user_iterator>
-Node::effect_users() {
-  is_effect_use Pred(this);
-  effect_user_iterator it_begin(Pred, Users.begin(), Users.end()),
-                       it_end(Pred, Users.end(), Users.end());
-  return llvm::make_range(it_begin, it_end);
-}
-
 bool Node::ReplaceUseOfWith(Node* From, Node* To, Use::Kind UseKind) {
   switch(UseKind) {
   case Use::K_NONE:
@@ -192,30 +197,19 @@ bool Node::ReplaceUseOfWith(Node* From, Node* To, Use::Kind UseKind) {
 }
 
 void Node::ReplaceWith(Node* Replacement, Use::Kind UseKind) {
-  switch(UseKind) {
-  case Use::K_NONE:
+  if(UseKind == Use::K_NONE) {
     // replace every category of uses
     ReplaceWith(Replacement, Use::K_VALUE);
     ReplaceWith(Replacement, Use::K_CONTROL);
     ReplaceWith(Replacement, Use::K_EFFECT);
-    break;
-  case Use::K_VALUE: {
-    std::vector<Node*> Usrs(value_users().begin(), value_users().end());
-    for(Node* Usr : Usrs)
-      Usr->ReplaceUseOfWith(this, Replacement, UseKind);
-    break;
-  }
-  case Use::K_CONTROL: {
-    std::vector<Node*> Usrs(control_users().begin(), control_users().end());
-    for(Node* Usr : Usrs)
-      Usr->ReplaceUseOfWith(this, Replacement, UseKind);
-    break;
-  }
-  case Use::K_EFFECT: {
-    std::vector<Node*> Usrs(effect_users().begin(), effect_users().end());
-    for(Node* Usr : Usrs)
-      Usr->ReplaceUseOfWith(this, Replacement, UseKind);
-    break;
+    return;
   }
+  assert(!IsSharedNode && "User lists of shared node are detached");
+  // visit the use list backward, so the record moved into
+  // the hole by each unlink is always a visited one
+  auto& KindUsers = getUsers(UseKind);
+  for(auto i = KindUsers.size(); i > 0; --i) {
+    auto E = KindUsers[i - 1];
+    E.User->setRawInput(E.InputIdx, Replacement);
   }
 }
@@ -1,17 +1,54 @@
 #include "gross/Graph/Graph.h"
 #include "gross/Graph/NodeMarker.h"
+#include <limits>
 
 using namespace gross;
 
-NodeMarkerBase::NodeMarkerBase(Graph& G, unsigned NumState)
-  : MarkerMin(G.MarkerMax), MarkerMax(G.MarkerMax += NumState){
+NodeMarkerBase::NodeMarkerBase(Graph& graph, unsigned NumStates)
+  : G(&graph), Slot(0U), NumState(NumStates),
+    MarkerMin(0U), MarkerMax(0U) {
   assert(NumState != 0U);
-  assert(MarkerMin < MarkerMax && "Wraparound!");
+  assert(!G->IsConcurrentBuild() &&
+         "NodeMarker should be created before building concurrently");
+  // pick the least occupied slot
+  for(unsigned i = 1U; i < Node::NumMarkerSlots; ++i) {
+    if(G->NumActiveMarkers[i] < G->NumActiveMarkers[Slot])
+      Slot = i;
+  }
+  ++G->NumActiveMarkers[Slot];
+  NewGeneration();
+}
+
+NodeMarkerBase::NodeMarkerBase(NodeMarkerBase&& Other)
+  : G(Other.G), Slot(Other.Slot), NumState(Other.NumState),
+    MarkerMin(Other.MarkerMin), MarkerMax(Other.MarkerMax) {
+  Other.G = nullptr;
+}
+
+NodeMarkerBase::~NodeMarkerBase() {
+  if(!G) return;
+  assert(G->NumActiveMarkers[Slot] > 0U);
+  --G->NumActiveMarkers[Slot];
+}
+
+void NodeMarkerBase::NewGeneration() {
+  auto& SlotMax = G->MarkerMax[Slot];
+  if(std::numeric_limits<MarkerTy>::max() - SlotMax < NumState) {
+    // running out of state ranges, start over by
+    // clearing this slot on every node
+    assert(G->NumActiveMarkers[Slot] == 1U &&
+           "Wraparound while other markers are using this slot");
+    for(auto* N : G->Nodes)
+      N->MarkerData[Slot] = 0U;
+    SlotMax = 0U;
+  }
+  MarkerMin = SlotMax;
+  MarkerMax = (SlotMax += NumState);
 }
 
 NodeMarkerBase::MarkerTy
 NodeMarkerBase::Get(Node* N) {
-  auto Data = N->MarkerData;
+  auto Data = N->MarkerData[Slot];
   if(Data < MarkerMin) return 0;
   assert(Data < MarkerMax &&
          "Using an old NodeMarker?");
@@ -20,6 +57,6 @@ NodeMarkerBase::Get(Node* N) {
 
 void NodeMarkerBase::Set(Node* N, NodeMarkerBase::MarkerTy NewMarker) {
   assert(NewMarker < (MarkerMax - MarkerMin));
-  assert(N->MarkerData < MarkerMax);
-  N->MarkerData = (MarkerMin + NewMarker);
+  assert(N->MarkerData[Slot] < MarkerMax);
+  N->MarkerData[Slot] = (MarkerMin + NewMarker);
 }
@@ -21,3 +21,27 @@ Node* gross::FindNearestCtrlPoint(Node* N) {
   }
   return nullptr;
 }
+
+bool gross::IsMainFunction(const Graph& G, const SubGraph& SG) {
+  for(auto* CI : SG.getTail()->control_inputs()) {
+    if(CI->getOp() == IrOpcode::Start &&
+       NodeProperties<IrOpcode::Start>(CI).name(G) == "main")
+      return true;
+  }
+  return false;
+}
+
+void gross::RemoveLoadFromEffectChain(Node* Load, Node* End) {
+  assert(Load->getOp() == IrOpcode::MemLoad &&
+         Load->getNumEffectInput() == 1);
+  assert(End->getOp() == IrOpcode::End);
+  auto* Effect = Load->getEffectInput(0);
+  Load->ReplaceWith(Effect, Use::K_EFFECT);
+  // initial memory states don't carry any modification
+  if(Effect->getOp() == IrOpcode::Start ||
+     Effect->getOp() == IrOpcode::SrcInitialArray)
+    return;
+  for(auto* EU : Effect->effect_users())
+    if(EU != Load) return;
+  End->appendEffectInput(Effect);
+}
@@ -57,12 +57,25 @@ GraphReduction CSEReducer::ReduceArithmetic(Node* N) {
      N->getNumControlInput())
     return NoChange();
 
+  if(G.IsValueNumberingEnabled()) {
+    // O(1) lookup in the hash-consing table instead
+    auto* Existing = G.AddValueNumber(N);
+    return Existing != N? Replace(Existing) : NoChange();
+  }
+
   auto OC = static_cast<unsigned>(N->getOp());
   if(!NodeOpMap[OC].count(N))
     NodeOpMap[OC].insert(N);
 
   auto NewHash = GetNodeHash(N);
-  if(auto* NewNode = NodeHashMap.find_node(NewHash)) {
+  auto* NewNode = NodeHashMap.find_node(NewHash);
+  if(NewNode && NewNode->IsDead()) {
+    // killed by other reducers running in the same traversal
+    NodeHashMap.erase(NewNode);
+    NodeOpMap[OC].erase(NewNode);
+    NewNode = nullptr;
+  }
+  if(NewNode) {
     if(NewNode != N) {
       // replace with new node
       NodeHashMap.erase(N);
@@ -1,4 +1,5 @@
 #include "gross/Graph/Reductions/CSE.h"
+#include "gross/Graph/Reductions/Peephole.h"
 //#include "gross/Graph/Reductions/ValuePromotion.h"
 #include "gross/Graph/NodeUtils.h"
 #include "gtest/gtest.h"
@@ -64,6 +65,47 @@ TEST(GRCSEUnitTest, ArithmeticCSETest) {
   }
 }
 
+TEST(GRCSEUnitTest, FusedPeepholeCSETest) {
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_fused_cse1")
+               .AddParameter(Arg)
+               .Build();
+  auto* Const2 = NodeBuilder<IrOpcode::ConstantInt>(&G, 2)
+                 .Build();
+  auto* Const3 = NodeBuilder<IrOpcode::ConstantInt>(&G, 3)
+                 .Build();
+  auto* Const5 = NodeBuilder<IrOpcode::ConstantInt>(&G, 5)
+                 .Build();
+  // only identical to Val2 after constant folding
+  auto* Sum = NodeBuilder<IrOpcode::BinAdd>(&G)
+              .LHS(Const2).RHS(Const3)
+              .Build();
+  auto* Val1 = NodeBuilder<IrOpcode::BinAdd>(&G)
+               .LHS(Arg).RHS(Sum)
+               .Build();
+  auto* Val2 = NodeBuilder<IrOpcode::BinAdd>(&G)
+               .LHS(Const5).RHS(Arg)
+               .Build();
+  auto* RetVal = NodeBuilder<IrOpcode::BinMul>(&G)
+                 .LHS(Val1).RHS(Val2)
+                 .Build();
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  G.AddSubRegion(SubGraph(End));
+
+  GraphReducer::Run<PeepholeReducer, CSEReducer>(G);
+  NodeProperties<IrOpcode::VirtBinOps> BNP(RetVal);
+  EXPECT_EQ(BNP.LHS(), BNP.RHS());
+  NodeProperties<IrOpcode::VirtBinOps> LHSNP(BNP.LHS());
+  ASSERT_TRUE(LHSNP);
+  EXPECT_TRUE(LHSNP.LHS() == Const5 || LHSNP.RHS() == Const5);
+}
+
 TEST(GRCSEUnitTest, MemoryCSETest) {
   Graph G;
   auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
@@ -0,0 +1,173 @@
+#include "gross/Graph/Reductions/DeadStoreElimination.h"
+#include "gross/Graph/NodeUtils.h"
+#include <algorithm>
+#include <vector>
+
+using namespace gross;
+
+// number of memory states to look through before giving up
+static constexpr unsigned MaxChainWalkDepth = 16U;
+
+DeadStoreEliminationReducer::
+DeadStoreEliminationReducer(GraphEditor::Interface* editor)
+  : GraphEditor(editor),
+    G(Editor->GetGraph()),
+    DeadNode(NodeBuilder<IrOpcode::Dead>(&G).Build()),
+    MA(G) {
+  for(auto& SG : G.subregions()) {
+    bool IsMain = IsMainFunction(G, SG);
+    for(auto* N : SG.nodes()) {
+      if(N->getOp() == IrOpcode::MemStore && IsMain)
+        MainStores.insert(N);
+      else if(N->getOp() == IrOpcode::MemLoad)
+        LoadEnds[N] = SG.getTail();
+    }
+  }
+}
+
+bool DeadStoreEliminationReducer::IsUnobservedOnExit(Node* Store) const {
+  auto* BaseAddr = NodeProperties<IrOpcode::MemStore>(Store).BaseAddr();
+  if(BaseAddr->getOp() != IrOpcode::Alloca) return false;
+  // nobody observes the global variables after main returns
+  return !G.IsGlobalVar(BaseAddr) || MainStores.count(Store);
+}
+
+bool DeadStoreEliminationReducer::IsDeadStore(Node* Store) const {
+  auto* State = Store;
+  for(auto Depth = 0U; Depth < MaxChainWalkDepth; ++Depth) {
+    // the end of effect chain is also the end of function
+    bool ReachExit = !State->user_size(Use::K_EFFECT);
+    // look through the MemLoads that don't read this address
+    std::vector<Node*> Users;
+    for(auto* EU : State->effect_users()) {
+      if(EU->getOp() != IrOpcode::MemLoad) {
+        Users.push_back(EU);
+        continue;
+      }
+      if(MA.Query(EU, Store) != MemoryAlias::NoAlias) return false;
+      if(!EU->user_size(Use::K_EFFECT)) ReachExit = true;
+      Users.insert(Users.end(),
+                   EU->effect_users().begin(), EU->effect_users().end());
+    }
+
+    Node* NextStore = nullptr;
+    for(auto* U : Users) {
+      switch(U->getOp()) {
+      case IrOpcode::End:
+        ReachExit = true;
+        break;
+      case IrOpcode::MemStore:
+        // stores don't read the memory, but the chain
+        // should not fork
+        if(NextStore && NextStore != U) return false;
+        NextStore = U;
+        break;
+      default:
+        return false;
+      }
+    }
+    if(ReachExit && !IsUnobservedOnExit(Store)) return false;
+    if(!NextStore) return true;
+    // overwritten before anyone reads it
+    if(MA.Query(NextStore, Store) == MemoryAlias::MustAlias) return true;
+    State = NextStore;
+  }
+  return false;
+}
+
+void DeadStoreEliminationReducer::RemoveDeadLoads(Node* Store) {
+  // otherwise they might be the only consumers of
+  // the modifications on global variables
+  auto* SrcVal = NodeProperties<IrOpcode::MemStore>(Store).SrcVal();
+  std::vector<Node*> Worklist;
+  if(SrcVal) Worklist.push_back(SrcVal);
+  while(!Worklist.empty()) {
+    auto* N = Worklist.back();
+    Worklist.pop_back();
+    if(N->user_size() != 1) continue;
+    if(N->getOp() == IrOpcode::MemLoad) {
+      if(N->getNumEffectInput() == 1 && LoadEnds.count(N)) {
+        // might be dead once it reaches End
+        Revisit(N->getEffectInput(0));
+        RemoveLoadFromEffectChain(N, LoadEnds.at(N));
+      }
+      continue;
+    }
+    if(NodeProperties<IrOpcode::VirtBinOps>(N))
+      Worklist.insert(Worklist.end(),
+                      N->value_input_begin(), N->value_input_end());
+  }
+}
+
+GraphReduction DeadStoreEliminationReducer::ReduceMemoryStore(Node* N) {
+  if(!IsDeadStore(N)) return NoChange();
+
+  std::vector<Node*> EffectInputs(N->effect_input_begin(),
+                                  N->effect_input_end());
+  std::vector<Node*> EffectUsers(N->effect_users().begin(),
+                                 N->effect_users().end());
+  // MemLoad can only have single effect input
+  for(auto* EU : EffectUsers) {
+    if(EU->getOp() == IrOpcode::MemLoad && EffectInputs.size() != 1)
+      return NoChange();
+  }
+
+  for(auto* EU : EffectUsers) {
+    EU->removeEffectInputAll(N);
+    std::vector<Node*> NewInputs;
+    for(auto* EI : EffectInputs) {
+      // End only needs to keep the memory state alive, MemLoads
+      // that were there to order against this store are not needed
+      if(EU->getOp() == IrOpcode::End &&
+         EI->getOp() == IrOpcode::MemLoad && EI->getNumEffectInput() == 1)
+        EI = EI->getEffectInput(0);
+      // neither the initial memory state of arrays
+      if(EU->getOp() == IrOpcode::End &&
+         EI->getOp() == IrOpcode::SrcInitialArray)
+        continue;
+      if(std::find(NewInputs.begin(), NewInputs.end(), EI)
+         == NewInputs.end())
+        NewInputs.push_back(EI);
+    }
+    for(auto* EI : NewInputs)
+      EU->appendEffectInput(EI);
+  }
+  RemoveDeadLoads(N);
+  // previous stores might be dead now
+  for(auto* EI : EffectInputs) {
+    if(EI->getOp() == IrOpcode::MemLoad && EI->getNumEffectInput() == 1)
+      Revisit(EI->getEffectInput(0));
+    else
+      Revisit(EI);
+  }
+  return Replace(DeadNode);
+}
+
+// MemLoads whose values are not used anymore, usually read by
+// the stores removed earlier, are only there to keep the order
+// against later stores
+GraphReduction DeadStoreEliminationReducer::ReduceMemoryLoad(Node* N) {
+  if(N->user_size(Use::K_VALUE) || N->getNumEffectInput() != 1 ||
+     !N->user_size(Use::K_EFFECT))
+    return NoChange();
+  for(auto* EU : N->effect_users()) {
+    if(EU->getOp() == IrOpcode::Phi ||
+       EU->getOp() == IrOpcode::EffectMerge)
+      return NoChange();
+  }
+  auto* Effect = N->getEffectInput(0);
+  N->ReplaceWith(Effect, Use::K_EFFECT);
+  Revisit(Effect);
+  return Replace(DeadNode);
+}
+
+GraphReduction DeadStoreEliminationReducer::Reduce(Node* N) {
+  switch(N->getOp()) {
+  case IrOpcode::MemStore:
+    return ReduceMemoryStore(N);
+  case IrOpcode::MemLoad:
+    return ReduceMemoryLoad(N);
+  default:
+    return NoChange();
+  }
+}
@@ -0,0 +1,137 @@
+#include "gross/Graph/Reductions/DeadStoreElimination.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gtest/gtest.h"
+#include <fstream>
+
+using namespace gross;
+
+TEST(GRDeadStoreEliminationUnitTest, OverwrittenStoreTest) {
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_dse_overwritten")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* One = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Eight = NodeBuilder<IrOpcode::ConstantInt>(&G, 8).Build();
+
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Eight).Build();
+  auto* Init = NodeBuilder<IrOpcode::SrcInitialArray>(&G, Alloca)
+               .Build();
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(Arg).Build();
+  Store1->appendEffectInput(Init);
+  // read another place
+  auto* Load1 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Four)
+                .Build();
+  Load1->appendEffectInput(Store1);
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Four)
+                 .Src(Arg).Build();
+  Store2->appendEffectInput(Load1);
+  // overwrite Store1
+  auto* Store3 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(One).Build();
+  Store3->appendEffectInput(Store2);
+  auto* Load2 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Zero)
+                .Build();
+  Load2->appendEffectInput(Store3);
+  auto* Load3 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Four)
+                .Build();
+  Load3->appendEffectInput(Store3);
+
+  auto* Sum = NodeBuilder<IrOpcode::BinAdd>(&G)
+              .LHS(Load1).RHS(Load2)
+              .Build();
+  auto* RetVal = NodeBuilder<IrOpcode::BinAdd>(&G)
+                 .LHS(Sum).RHS(Load3)
+                 .Build();
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestDSEOverwritten.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<DeadStoreEliminationReducer>(G);
+  {
+    std::ofstream OF("TestDSEOverwritten.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  ASSERT_EQ(Load1->getNumEffectInput(), 1);
+  EXPECT_EQ(Load1->getEffectInput(0), Init);
+  // Store2 is read by Load3
+  ASSERT_EQ(Store3->getNumEffectInput(), 1);
+  EXPECT_EQ(Store3->getEffectInput(0), Store2);
+}
+
+TEST(GRDeadStoreEliminationUnitTest, FunctionExitTest) {
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_dse_exit")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Eight = NodeBuilder<IrOpcode::ConstantInt>(&G, 8).Build();
+
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Eight).Build();
+  auto* Init = NodeBuilder<IrOpcode::SrcInitialArray>(&G, Alloca)
+               .Build();
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(Arg).Build();
+  Store1->appendEffectInput(Init);
+  // might read Store1
+  auto* Offset = NodeBuilder<IrOpcode::BinMul>(&G)
+                 .LHS(Arg).RHS(Four)
+                 .Build();
+  auto* Load = NodeBuilder<IrOpcode::MemLoad>(&G)
+               .BaseAddr(Alloca).Offset(Offset)
+               .Build();
+  Load->appendEffectInput(Store1);
+  // never read before the function returns
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Four)
+                 .Src(Arg).Build();
+  Store2->appendEffectInput(Load);
+
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, Load)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .AddEffectDep(Store2)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestDSEExit.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<DeadStoreEliminationReducer>(G);
+  {
+    std::ofstream OF("TestDSEExit.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  ASSERT_EQ(Load->getNumEffectInput(), 1);
+  EXPECT_EQ(Load->getEffectInput(0), Store1);
+  // End doesn't need to be ordered after the load
+  ASSERT_EQ(End->getNumEffectInput(), 1);
+  EXPECT_EQ(End->getEffectInput(0), Store1);
+}
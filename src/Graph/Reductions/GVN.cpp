@@ -0,0 +1,286 @@
+#include "gross/Graph/Reductions/GVN.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gross/Support/Statistics.h"
+#include "boost/functional/hash.hpp"
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+using namespace gross;
+
+// number of nested PHIs to look through when searching
+// the last stored value
+static constexpr size_t MaxContentSearchDepth = 16U;
+
+size_t GVNReducer::CongruenceKeyHash::operator()(const CongruenceKey& Key)
+  const {
+  size_t Seed = std::hash<unsigned>{}(static_cast<unsigned>(Key.Op));
+  boost::hash_combine(Seed, std::hash<Node*>{}(Key.Pin));
+  for(auto* N : Key.Operands)
+    boost::hash_combine(Seed, std::hash<Node*>{}(N));
+  return Seed;
+}
+
+GVNReducer::GVNReducer(GraphEditor::Interface* editor)
+  : GraphEditor(editor),
+    G(Editor->GetGraph()),
+    ValueNumbers(G.getNumNodeIds()),
+    MemoryStates(G.getNumNodeIds()) {
+  for(auto& SG : G.subregions())
+    Analyze(SG);
+}
+
+Node* GVNReducer::getValueNumber(Node* N) const {
+  // nodes that are not analyzed are only congruent to themselves
+  return ValueNumbers.count(N)? ValueNumbers.at(N) : N;
+}
+Node* GVNReducer::getMemoryState(Node* N) const {
+  return MemoryStates.count(N)? MemoryStates.at(N) : N;
+}
+
+Node* GVNReducer::LookupOrInsert(congruence_table& Table,
+                                 CongruenceKey&& Key, Node* N) {
+  return Table.insert({std::move(Key), N}).first->second;
+}
+
+Node* GVNReducer::TryMerge(const std::vector<Node*>& Inputs) {
+  Node* Val = nullptr;
+  for(auto* N : Inputs) {
+    // unknown input is optimistically assumed to be congruent
+    if(!N) continue;
+    if(!Val) Val = N;
+    else if(Val != N) return nullptr;
+  }
+  return Val;
+}
+
+bool GVNReducer::FindMemoryContent(Node* State,
+                                   Node* BaseAddr, Node* Offset,
+                                   Node*& Content,
+                                   std::vector<Node*>& Visiting) const {
+  if(!State) {
+    // optimistically assume it's congruent with anything
+    Content = nullptr;
+    return true;
+  }
+
+  switch(State->getOp()) {
+  case IrOpcode::MemStore: {
+    NodeProperties<IrOpcode::MemStore> NP(State);
+    if(!NP.SrcVal() ||
+       getValueNumber(NP.BaseAddr()) != BaseAddr ||
+       getValueNumber(NP.Offset()) != Offset)
+      return false;
+    Content = getValueNumber(NP.SrcVal());
+    return true;
+  }
+  case IrOpcode::Phi: {
+    if(!State->getNumEffectInput()) return false;
+    if(std::find(Visiting.begin(), Visiting.end(), State)
+       != Visiting.end()) {
+      // reaching the same PHI again from backedge
+      Content = nullptr;
+      return true;
+    }
+    if(Visiting.size() >= MaxContentSearchDepth) return false;
+
+    Visiting.push_back(State);
+    bool Found = true;
+    std::vector<Node*> Contents;
+    for(auto* EI : State->effect_inputs()) {
+      Node* C;
+      if(!FindMemoryContent(getMemoryState(EI), BaseAddr, Offset,
+                            C, Visiting)) {
+        Found = false;
+        break;
+      }
+      Contents.push_back(C);
+    }
+    Visiting.pop_back();
+    if(!Found) return false;
+
+    Content = TryMerge(Contents);
+    // different values from different predecessors
+    return Content ||
+           std::all_of(Contents.begin(), Contents.end(),
+                       [](Node* C) { return !C; });
+  }
+  default:
+    return false;
+  }
+}
+
+Node* GVNReducer::ComputeValueNumber(Node* N, congruence_table& Table) {
+  switch(N->getOp()) {
+#define COMMON_OP(OC) \
+  case IrOpcode::OC:
+#include "gross/Graph/Opcodes.def"
+  {
+    if(N->getNumEffectInput() || N->getNumControlInput() ||
+       N->getNumValueInput() != 2)
+      return N;
+    auto* LHS = getValueNumber(N->getValueInput(0));
+    auto* RHS = getValueNumber(N->getValueInput(1));
+    if(!LHS || !RHS) return nullptr;
+    if(NodeProperties<IrOpcode::VirtBinOps>(N).IsCommutative() &&
+       LHS->getId() > RHS->getId())
+      std::swap(LHS, RHS);
+    return LookupOrInsert(Table, {N->getOp(), nullptr, {LHS, RHS}}, N);
+  }
+  case IrOpcode::Phi: {
+    if(!N->getNumValueInput() || N->getNumControlInput() != 1)
+      return N;
+    std::vector<Node*> Inputs;
+    for(auto* VI : N->value_inputs())
+      Inputs.push_back(getValueNumber(VI));
+    if(std::all_of(Inputs.begin(), Inputs.end(),
+                   [](Node* VN) { return !VN; }))
+      return nullptr;
+    // including the case where the backedge value is
+    // congruent with the initial value
+    if(auto* MergeVal = TryMerge(Inputs)) return MergeVal;
+    return LookupOrInsert(Table,
+                          {IrOpcode::Phi, N->getControlInput(0),
+                           std::move(Inputs)}, N);
+  }
+  case IrOpcode::MemLoad: {
+    if(N->getNumEffectInput() != 1 || N->getNumValueInput() != 2)
+      return N;
+    auto* Effect = N->getEffectInput(0);
+    auto* State = getMemoryState(Effect);
+    NodeProperties<IrOpcode::MemLoad> NP(N);
+    auto* BaseAddr = getValueNumber(NP.BaseAddr());
+    auto* Offset = getValueNumber(NP.Offset());
+    if(!BaseAddr || !Offset) return nullptr;
+
+    Node* Content;
+    std::vector<Node*> Visiting;
+    if(FindMemoryContent(State, BaseAddr, Offset, Content, Visiting))
+      return Content;
+    // merging with loads that have other effect inputs
+    // might break the order against later stores
+    if(State != Effect) return N;
+    std::vector<Node*> Operands{BaseAddr, Offset};
+    Operands.insert(Operands.end(),
+                    N->control_input_begin(), N->control_input_end());
+    return LookupOrInsert(Table,
+                          {IrOpcode::MemLoad, Effect, std::move(Operands)},
+                          N);
+  }
+  default:
+    return N;
+  }
+}
+
+Node* GVNReducer::ComputeMemoryState(Node* N, congruence_table& Table) {
+  switch(N->getOp()) {
+  case IrOpcode::MemLoad:
+    // loads don't change the memory
+    if(N->getNumEffectInput() == 1)
+      return getMemoryState(N->getEffectInput(0));
+    return N;
+  case IrOpcode::Phi:
+  case IrOpcode::EffectMerge: {
+    if(!N->getNumEffectInput()) return N;
+    std::vector<Node*> States;
+    for(auto* EI : N->effect_inputs())
+      States.push_back(getMemoryState(EI));
+    if(std::all_of(States.begin(), States.end(),
+                   [](Node* MS) { return !MS; }))
+      return nullptr;
+    if(auto* MergeState = TryMerge(States)) return MergeState;
+    if(N->getOp() == IrOpcode::Phi && N->getNumControlInput() == 1)
+      return LookupOrInsert(Table,
+                            {IrOpcode::Phi, N->getControlInput(0),
+                             std::move(States)}, N);
+    return N;
+  }
+  default:
+    return N;
+  }
+}
+
+void GVNReducer::Analyze(SubGraph& SG) {
+  // post order visits inputs before users except on backedges,
+  // which are exactly where the optimistic assumptions are made
+  std::vector<Node*> Nodes;
+  for(auto* N : SG.po_nodes()) {
+    if(N->getOp() == IrOpcode::Dead || N->IsDead()) continue;
+    Nodes.push_back(N);
+    ValueNumbers[N] = nullptr;
+    MemoryStates[N] = nullptr;
+    if(N->getOp() == IrOpcode::MemLoad)
+      LoadEnds[N] = SG.getTail();
+  }
+
+  unsigned NumIterations = 0U;
+  bool Changed;
+  do {
+    Changed = false;
+    ++NumIterations;
+    // keys are rebuilt from scratch in every iteration since
+    // the value numbers they're made of might be changed
+    congruence_table ValueTable, StateTable;
+    for(auto* N : Nodes) {
+      auto* VN = ComputeValueNumber(N, ValueTable);
+      if(VN != ValueNumbers[N]) {
+        ValueNumbers[N] = VN;
+        Changed = true;
+      }
+      auto* MS = ComputeMemoryState(N, StateTable);
+      if(MS != MemoryStates[N]) {
+        MemoryStates[N] = MS;
+        Changed = true;
+      }
+    }
+  } while(Changed);
+  Statistics::Get().AddCounter(name(), "iterations", NumIterations);
+}
+
+GraphReduction GVNReducer::ReducePhi(Node* N) {
+  auto* Leader = ValueNumbers.at(N);
+  if(!Leader || Leader == N || !N->getNumValueInput())
+    return NoChange();
+  if(!N->getNumEffectInput())
+    return Replace(Leader);
+
+  // keep the effect part
+  N->ReplaceWith(Leader, Use::K_VALUE);
+  return Replace(N);
+}
+
+GraphReduction GVNReducer::ReduceMemoryLoad(Node* N) {
+  auto* Leader = ValueNumbers.at(N);
+  if(!Leader || Leader == N) return NoChange();
+
+  auto* Effect = N->getEffectInput(0);
+  if(Leader->getOp() != IrOpcode::MemLoad ||
+     Leader->getNumEffectInput() != 1 ||
+     Leader->getEffectInput(0) != Effect) {
+    // forwarded from a store: remove this load from the effect chain
+    RemoveLoadFromEffectChain(N, LoadEnds.at(N));
+  }
+  return Replace(Leader);
+}
+
+GraphReduction GVNReducer::Reduce(Node* N) {
+  // created after the analysis
+  if(!ValueNumbers.count(N)) return NoChange();
+
+  switch(N->getOp()) {
+#define COMMON_OP(OC) \
+  case IrOpcode::OC:
+#include "gross/Graph/Opcodes.def"
+  {
+    auto* Leader = ValueNumbers.at(N);
+    if(Leader && Leader != N) return Replace(Leader);
+    return NoChange();
+  }
+  case IrOpcode::Phi:
+    return ReducePhi(N);
+  case IrOpcode::MemLoad:
+    return ReduceMemoryLoad(N);
+  default:
+    return NoChange();
+  }
+}
@@ -0,0 +1,195 @@
+#include "gross/Graph/Reductions/GVN.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gtest/gtest.h"
+#include <fstream>
+
+using namespace gross;
+
+TEST(GRGVNUnitTest, LoopPHICongruenceTest) {
+  // two induction variables that are always equal
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "n").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_gvn_loop_phi")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* One = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+
+  auto* Cond = NodeBuilder<IrOpcode::BinLt>(&G)
+               .LHS(Arg).RHS(Zero)
+               .Build();
+  auto* Loop = NodeBuilder<IrOpcode::Loop>(&G, Func)
+               .Condition(Cond)
+               .Build();
+  auto* PHI1 = NodeBuilder<IrOpcode::Phi>(&G)
+               .SetCtrlMerge(Loop)
+               .AddValueInput(Zero).AddValueInput(Zero)
+               .Build();
+  auto* PHI2 = NodeBuilder<IrOpcode::Phi>(&G)
+               .SetCtrlMerge(Loop)
+               .AddValueInput(Zero).AddValueInput(Zero)
+               .Build();
+  auto* Inc1 = NodeBuilder<IrOpcode::BinAdd>(&G)
+               .LHS(PHI1).RHS(One)
+               .Build();
+  auto* Inc2 = NodeBuilder<IrOpcode::BinAdd>(&G)
+               .LHS(One).RHS(PHI2)
+               .Build();
+  PHI1->setValueInput(1, Inc1);
+  PHI2->setValueInput(1, Inc2);
+  // PHI whose backedge value is itself
+  auto* PHI3 = NodeBuilder<IrOpcode::Phi>(&G)
+               .SetCtrlMerge(Loop)
+               .AddValueInput(Arg).AddValueInput(Arg)
+               .Build();
+  PHI3->setValueInput(1, PHI3);
+
+  auto* Sum = NodeBuilder<IrOpcode::BinAdd>(&G)
+              .LHS(PHI1).RHS(PHI2)
+              .Build();
+  auto* RetVal = NodeBuilder<IrOpcode::BinMul>(&G)
+                 .LHS(Sum).RHS(PHI3)
+                 .Build();
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestGVNLoopPHI.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<GVNReducer>(G);
+  {
+    std::ofstream OF("TestGVNLoopPHI.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  NodeProperties<IrOpcode::VirtBinOps> BNP(Sum);
+  EXPECT_EQ(BNP.LHS(), BNP.RHS());
+  EXPECT_EQ(NodeProperties<IrOpcode::VirtBinOps>(RetVal).RHS(), Arg);
+}
+
+TEST(GRGVNUnitTest, MemoryStateCongruenceTest) {
+  // loads before and inside a loop that doesn't write the memory
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_gvn_memory")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Four).Build();
+  auto* Store = NodeBuilder<IrOpcode::MemStore>(&G)
+                .BaseAddr(Alloca).Offset(Zero)
+                .Src(Arg).Build();
+  auto* Load1 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Zero)
+                .Build();
+  Load1->appendEffectInput(Store);
+
+  auto* Cond = NodeBuilder<IrOpcode::BinLt>(&G)
+               .LHS(Arg).RHS(Zero)
+               .Build();
+  auto* Loop = NodeBuilder<IrOpcode::Loop>(&G, Func)
+               .Condition(Cond)
+               .Build();
+  auto* PHI = NodeBuilder<IrOpcode::Phi>(&G)
+              .SetCtrlMerge(Loop)
+              .AddEffectInput(Store).AddEffectInput(Store)
+              .Build();
+  auto* Load2 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Zero)
+                .Build();
+  Load2->appendEffectInput(PHI);
+  PHI->setEffectInput(1, Load2);
+
+  auto* RetVal = NodeBuilder<IrOpcode::BinAdd>(&G)
+                 .LHS(Load1).RHS(Load2)
+                 .Build();
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestGVNMemory.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<GVNReducer>(G);
+  {
+    std::ofstream OF("TestGVNMemory.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  // both of them read the stored value
+  NodeProperties<IrOpcode::VirtBinOps> BNP(RetVal);
+  EXPECT_EQ(BNP.LHS(), Arg);
+  EXPECT_EQ(BNP.RHS(), Arg);
+}
+
+TEST(GRGVNUnitTest, LoopStoreForwardingTest) {
+  // the loop stores back the value it loads
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_gvn_loop_store")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Four).Build();
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(Arg).Build();
+
+  auto* Cond = NodeBuilder<IrOpcode::BinLt>(&G)
+               .LHS(Arg).RHS(Zero)
+               .Build();
+  auto* Loop = NodeBuilder<IrOpcode::Loop>(&G, Func)
+               .Condition(Cond)
+               .Build();
+  auto* PHI = NodeBuilder<IrOpcode::Phi>(&G)
+              .SetCtrlMerge(Loop)
+              .AddEffectInput(Store1).AddEffectInput(Store1)
+              .Build();
+  auto* Load = NodeBuilder<IrOpcode::MemLoad>(&G)
+               .BaseAddr(Alloca).Offset(Zero)
+               .Build();
+  Load->appendEffectInput(PHI);
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(Load).Build();
+  Store2->appendEffectInput(Load);
+  PHI->setEffectInput(1, Store2);
+
+  auto* RetVal = NodeBuilder<IrOpcode::BinAdd>(&G)
+                 .LHS(Load).RHS(Four)
+                 .Build();
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestGVNLoopStore.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<GVNReducer>(G);
+  {
+    std::ofstream OF("TestGVNLoopStore.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  EXPECT_EQ(NodeProperties<IrOpcode::VirtBinOps>(RetVal).LHS(), Arg);
+}
@@ -0,0 +1,86 @@
+#include "gross/Graph/Reductions/LoadElimination.h"
+#include "gross/Graph/NodeUtils.h"
+
+using namespace gross;
+
+// number of memory states to look through before giving up
+static constexpr unsigned MaxChainWalkDepth = 16U;
+
+LoadEliminationReducer::LoadEliminationReducer(GraphEditor::Interface* editor)
+  : GraphEditor(editor),
+    G(Editor->GetGraph()),
+    MA(G) {
+  for(auto& SG : G.subregions()) {
+    for(auto* N : SG.nodes()) {
+      if(N->getOp() == IrOpcode::MemLoad)
+        LoadEnds[N] = SG.getTail();
+    }
+  }
+}
+
+Node* LoadEliminationReducer::GetPrevState(Node* Store) const {
+  Node* PrevState = nullptr;
+  for(auto* EI : Store->effect_inputs()) {
+    auto* State = EI;
+    if(EI->getOp() == IrOpcode::MemLoad) {
+      if(EI->getNumEffectInput() != 1) return nullptr;
+      State = EI->getEffectInput(0);
+    }
+    if(!PrevState) PrevState = State;
+    else if(PrevState != State) return nullptr;
+  }
+  return PrevState;
+}
+
+Node* LoadEliminationReducer::FindLoad(Node* State, Node* Load) const {
+  for(auto* EU : State->effect_users()) {
+    if(EU == Load || EU->IsDead() ||
+       EU->getOp() != IrOpcode::MemLoad ||
+       EU->getNumEffectInput() != 1)
+      continue;
+    if(MA.Query(EU, Load) == MemoryAlias::MustAlias)
+      return EU;
+  }
+  return nullptr;
+}
+
+GraphReduction LoadEliminationReducer::ReduceMemoryLoad(Node* N) {
+  if(N->getNumEffectInput() != 1 || !N->user_size(Use::K_VALUE))
+    return NoChange();
+
+  auto* Effect = N->getEffectInput(0);
+  Node* Replacement = nullptr;
+  auto* State = Effect;
+  for(auto Depth = 0U; State && Depth < MaxChainWalkDepth; ++Depth) {
+    if(State->getOp() == IrOpcode::MemStore) {
+      auto AR = MA.Query(State, N);
+      if(AR == MemoryAlias::MustAlias) {
+        Replacement = NodeProperties<IrOpcode::MemStore>(State).SrcVal();
+        break;
+      }
+      if((Replacement = FindLoad(State, N))) break;
+      if(AR == MemoryAlias::MayAlias) break;
+      State = GetPrevState(State);
+    } else {
+      Replacement = FindLoad(State, N);
+      break;
+    }
+  }
+  if(!Replacement) return NoChange();
+
+  // PHIs and EffectMerges expect the loads legalized by MemoryLegalize
+  for(auto* EU : N->effect_users()) {
+    if(EU->getOp() == IrOpcode::Phi ||
+       EU->getOp() == IrOpcode::EffectMerge)
+      return NoChange();
+  }
+
+  RemoveLoadFromEffectChain(N, LoadEnds.at(N));
+  return Replace(Replacement);
+}
+
+GraphReduction LoadEliminationReducer::Reduce(Node* N) {
+  if(N->getOp() == IrOpcode::MemLoad)
+    return ReduceMemoryLoad(N);
+  return NoChange();
+}
@@ -0,0 +1,188 @@
+#include "gross/Graph/Reductions/LoadElimination.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gtest/gtest.h"
+#include <fstream>
+
+using namespace gross;
+
+TEST(GRLoadEliminationUnitTest, StoreForwardingTest) {
+  Graph G;
+  auto* Arg1 = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Arg2 = NodeBuilder<IrOpcode::Argument>(&G, "b").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_store_forwarding")
+               .AddParameter(Arg1).AddParameter(Arg2)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Eight = NodeBuilder<IrOpcode::ConstantInt>(&G, 8).Build();
+
+  auto* Alloca1 = NodeBuilder<IrOpcode::Alloca>(&G)
+                  .Size(Eight).Build();
+  auto* Alloca2 = NodeBuilder<IrOpcode::Alloca>(&G)
+                  .Size(Four).Build();
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca1).Offset(Zero)
+                 .Src(Arg1).Build();
+  // constant distance away on the same Alloca
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca1).Offset(Four)
+                 .Src(Arg2).Build();
+  Store2->appendEffectInput(Store1);
+  // on another Alloca
+  auto* Store3 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca2).Offset(Zero)
+                 .Src(Arg2).Build();
+  Store3->appendEffectInput(Store2);
+  auto* Load1 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca1).Offset(Zero)
+                .Build();
+  Load1->appendEffectInput(Store3);
+
+  // unknown offset on the same Alloca
+  auto* Offset = NodeBuilder<IrOpcode::BinMul>(&G)
+                 .LHS(Arg2).RHS(Four)
+                 .Build();
+  auto* Store4 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca1).Offset(Offset)
+                 .Src(Arg2).Build();
+  Store4->appendEffectInput(Load1);
+  auto* Load2 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca1).Offset(Zero)
+                .Build();
+  Load2->appendEffectInput(Store4);
+
+  auto* RetVal = NodeBuilder<IrOpcode::BinAdd>(&G)
+                 .LHS(Load1).RHS(Load2)
+                 .Build();
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestLoadElimStore.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<LoadEliminationReducer>(G);
+  {
+    std::ofstream OF("TestLoadElimStore.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  NodeProperties<IrOpcode::VirtBinOps> BNP(RetVal);
+  EXPECT_EQ(BNP.LHS(), Arg1);
+  EXPECT_EQ(BNP.RHS(), Load2);
+  // Load1 is removed from the effect chain
+  ASSERT_EQ(Store4->getNumEffectInput(), 1);
+  EXPECT_EQ(Store4->getEffectInput(0), Store3);
+}
+
+TEST(GRLoadEliminationUnitTest, LoadReuseTest) {
+  Graph G;
+  auto* Arg1 = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Arg2 = NodeBuilder<IrOpcode::Argument>(&G, "i").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_load_reuse")
+               .AddParameter(Arg1).AddParameter(Arg2)
+               .Build();
+  auto* One = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Size = NodeBuilder<IrOpcode::ConstantInt>(&G, 40).Build();
+
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Size).Build();
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Four)
+                 .Src(Arg1).Build();
+  // Alloca[i]
+  auto* Offset1 = NodeBuilder<IrOpcode::BinMul>(&G)
+                  .LHS(Arg2).RHS(Four)
+                  .Build();
+  auto* Load1 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Offset1)
+                .Build();
+  Load1->appendEffectInput(Store1);
+  // Alloca[i + 1]
+  auto* Index = NodeBuilder<IrOpcode::BinAdd>(&G)
+                .LHS(Arg2).RHS(One)
+                .Build();
+  auto* Offset2 = NodeBuilder<IrOpcode::BinMul>(&G)
+                  .LHS(Index).RHS(Four)
+                  .Build();
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Offset2)
+                 .Src(Arg1).Build();
+  Store2->appendEffectInput(Load1);
+  // Alloca[i] again
+  auto* Offset3 = NodeBuilder<IrOpcode::BinMul>(&G)
+                  .LHS(Four).RHS(Arg2)
+                  .Build();
+  auto* Load2 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Offset3)
+                .Build();
+  Load2->appendEffectInput(Store2);
+
+  auto* RetVal = NodeBuilder<IrOpcode::BinSub>(&G)
+                 .LHS(Load1).RHS(Load2)
+                 .Build();
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestLoadElimReuse.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<LoadEliminationReducer>(G);
+  {
+    std::ofstream OF("TestLoadElimReuse.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  NodeProperties<IrOpcode::VirtBinOps> BNP(RetVal);
+  EXPECT_EQ(BNP.LHS(), Load1);
+  EXPECT_EQ(BNP.RHS(), Load1);
+}
+
+TEST(GRLoadEliminationUnitTest, KeepStoreAliveTest) {
+  Graph G;
+  auto* Arg1 = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_keep_store_alive")
+               .AddParameter(Arg1)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+
+  auto* GlobalVar = NodeBuilder<IrOpcode::Alloca>(&G)
+                    .Size(Four).Build();
+  G.MarkGlobalVar(GlobalVar);
+  auto* Store = NodeBuilder<IrOpcode::MemStore>(&G)
+                .BaseAddr(GlobalVar).Offset(Zero)
+                .Src(Arg1).Build();
+  // the only effect user of Store
+  auto* Load = NodeBuilder<IrOpcode::MemLoad>(&G)
+               .BaseAddr(GlobalVar).Offset(Zero)
+               .Build();
+  Load->appendEffectInput(Store);
+
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, Load)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+
+  GraphReducer::RunWithEditor<LoadEliminationReducer>(G);
+  EXPECT_EQ(Return->getValueInput(0), Arg1);
+  // the store to global variable is still observable
+  ASSERT_EQ(End->getNumEffectInput(), 1);
+  EXPECT_EQ(End->getEffectInput(0), Store);
+}
@@ -0,0 +1,98 @@
+#include "gross/Graph/Reductions/LoadHoisting.h"
+#include "gross/Graph/NodeUtils.h"
+#include <set>
+#include <vector>
+
+using namespace gross;
+
+LoadHoistingReducer::LoadHoistingReducer(GraphEditor::Interface* editor)
+  : GraphEditor(editor),
+    G(Editor->GetGraph()),
+    MA(G),
+    LA(G) {
+  for(auto& SG : G.subregions()) {
+    for(auto* N : SG.nodes()) {
+      if(N->getOp() == IrOpcode::MemLoad)
+        LoadEnds[N] = SG.getTail();
+    }
+  }
+}
+
+bool LoadHoistingReducer::IsClobberedInLoop(Node* Load, Node* LoopPHI,
+                                            Node* Backedge) {
+  std::set<Node*> Visited;
+  std::vector<Node*> Worklist{Backedge};
+  while(!Worklist.empty()) {
+    auto* N = Worklist.back();
+    Worklist.pop_back();
+    if(N == LoopPHI || !Visited.insert(N).second) continue;
+    switch(N->getOp()) {
+    case IrOpcode::MemStore:
+      if(MA.Query(N, Load) != MemoryAlias::NoAlias) return true;
+      break;
+    case IrOpcode::MemLoad:
+    case IrOpcode::EffectMerge:
+      break;
+    case IrOpcode::Phi:
+      // effect PHIs within the loop
+      if(N->getNumValueInput()) return true;
+      break;
+    default:
+      return true;
+    }
+    // never reach the loop PHI on this path
+    if(!N->getNumEffectInput()) return true;
+    for(auto* EI : N->effect_inputs())
+      Worklist.push_back(EI);
+  }
+  return false;
+}
+
+GraphReduction LoadHoistingReducer::ReduceMemoryLoad(Node* N) {
+  if(N->getNumEffectInput() != 1 || !N->user_size(Use::K_VALUE))
+    return NoChange();
+  NodeProperties<IrOpcode::MemLoad> NP(N);
+
+  // look through the stores that don't write to this address
+  auto* Effect = N->getEffectInput(0);
+  auto* State = Effect;
+  while(State->getOp() == IrOpcode::MemStore &&
+        State->getNumEffectInput() == 1 &&
+        MA.Query(State, N) == MemoryAlias::NoAlias)
+    State = State->getEffectInput(0);
+
+  NodeProperties<IrOpcode::Phi> PNP(State);
+  if(!PNP || State->getNumValueInput() ||
+     State->getNumEffectInput() != 2)
+    return NoChange();
+  auto* Loop = PNP.CtrlPivot();
+  if(Loop->getOp() != IrOpcode::Loop) return NoChange();
+
+  if(LA.IsInLoop(NP.BaseAddr(), Loop) || LA.IsInLoop(NP.Offset(), Loop))
+    return NoChange();
+  // effect inputs are in the same order as control inputs of Loop
+  auto* PreLoopState = State->getEffectInput(0);
+  auto* BackedgeState = State->getEffectInput(1);
+  if(IsClobberedInLoop(N, State, BackedgeState))
+    return NoChange();
+
+  // PHIs and EffectMerges expect the loads legalized by MemoryLegalize
+  for(auto* EU : N->effect_users()) {
+    if(EU->getOp() == IrOpcode::Phi ||
+       EU->getOp() == IrOpcode::EffectMerge)
+      return NoChange();
+  }
+
+  // take the load out of the loop's effect chain
+  RemoveLoadFromEffectChain(N, LoadEnds.at(N));
+  N->ReplaceUseOfWith(Effect, PreLoopState, Use::K_EFFECT);
+  // nodes that depend on this load might be loop invariant now
+  LA.invalidate();
+  return Replace(N);
+}
+
+GraphReduction LoadHoistingReducer::Reduce(Node* N) {
+  if(N->getOp() == IrOpcode::MemLoad)
+    return ReduceMemoryLoad(N);
+  return NoChange();
+}
@@ -0,0 +1,80 @@
+#include "gross/Graph/Reductions/LoadHoisting.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gtest/gtest.h"
+#include <fstream>
+
+using namespace gross;
+
+TEST(GRLoadHoistingUnitTest, LoopInvariantLoadTest) {
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_load_hoisting")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Eight = NodeBuilder<IrOpcode::ConstantInt>(&G, 8).Build();
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Eight).Build();
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(Arg).Build();
+
+  auto* Cond = NodeBuilder<IrOpcode::BinLt>(&G)
+               .LHS(Arg).RHS(Zero)
+               .Build();
+  auto* Loop = NodeBuilder<IrOpcode::Loop>(&G, Func)
+               .Condition(Cond)
+               .Build();
+  auto* PHI = NodeBuilder<IrOpcode::Phi>(&G)
+              .SetCtrlMerge(Loop)
+              .AddEffectInput(Store1).AddEffectInput(Store1)
+              .Build();
+  // Alloca[0] is never written in the loop
+  auto* Load1 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Zero)
+                .Build();
+  Load1->appendEffectInput(PHI);
+  // Alloca[1] is written in every iteration
+  auto* Load2 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Four)
+                .Build();
+  Load2->appendEffectInput(PHI);
+  auto* Sum = NodeBuilder<IrOpcode::BinAdd>(&G)
+              .LHS(Load1).RHS(Load2)
+              .Build();
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Four)
+                 .Src(Sum).Build();
+  Store2->appendEffectInput(Load1);
+  Store2->appendEffectInput(Load2);
+  PHI->setEffectInput(1, Store2);
+
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, Sum)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestLoadHoisting.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<LoadHoistingReducer>(G);
+  {
+    std::ofstream OF("TestLoadHoisting.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  // Load1 reads the pre-loop state now
+  ASSERT_EQ(Load1->getNumEffectInput(), 1);
+  EXPECT_EQ(Load1->getEffectInput(0), Store1);
+  ASSERT_EQ(Load2->getNumEffectInput(), 1);
+  EXPECT_EQ(Load2->getEffectInput(0), PHI);
+  // and is no longer part of the loop's effect chain
+  ASSERT_EQ(Store2->getNumEffectInput(), 2);
+  EXPECT_EQ(Store2->getEffectInput(0), PHI);
+  EXPECT_EQ(Store2->getEffectInput(1), Load2);
+}
@@ -0,0 +1,124 @@
+#include "gross/Graph/Reductions/LoopAnalysis.h"
+#include "gross/Graph/NodeUtils.h"
+#include <set>
+#include <vector>
+
+using namespace gross;
+
+bool LoopAnalysis::IsCtrlInLoop(Node* Ctrl, Node* Loop) {
+  // walk up the control flow without going through
+  // any back edge. Nodes after the loop also reach the
+  // loop header, but they can't be used inside the loop
+  std::set<Node*> Visited;
+  std::vector<Node*> Worklist{Ctrl};
+  while(!Worklist.empty()) {
+    auto* CN = Worklist.back();
+    Worklist.pop_back();
+    if(CN == Loop) return true;
+    if(!Visited.insert(CN).second) continue;
+    for(auto* CI : CN->control_inputs()) {
+      if(CN->getOp() == IrOpcode::Loop &&
+         NodeProperties<IrOpcode::Loop>(CN).Backedge() == CI)
+        continue;
+      Worklist.push_back(CI);
+    }
+  }
+  return false;
+}
+
+bool LoopAnalysis::IsInLoop(Node* N, Node* Loop) {
+  auto Key = std::make_pair(N, Loop);
+  if(InLoopCache.count(Key)) return InLoopCache.at(Key);
+  // break the cycles, which can only go through PHIs anyway
+  InLoopCache[Key] = false;
+
+  bool Result = false;
+  if(N->getOp() == IrOpcode::Phi) {
+    Result = IsCtrlInLoop(NodeProperties<IrOpcode::Phi>(N).CtrlPivot(),
+                          Loop);
+  } else if(N->getNumControlInput()) {
+    for(auto* CI : N->control_inputs()) {
+      if((Result = IsCtrlInLoop(CI, Loop))) break;
+    }
+  } else {
+    for(auto* Input : N->inputs()) {
+      if((Result = IsInLoop(Input, Loop))) break;
+    }
+  }
+  return InLoopCache[Key] = Result;
+}
+
+bool LoopAnalysis::GetInductionVariable(Node* PHI,
+                                        InductionVariable& IV) const {
+  NodeProperties<IrOpcode::Phi> PNP(PHI);
+  if(!PNP || PHI->getNumValueInput() != 2 ||
+     PHI->getNumEffectInput())
+    return false;
+  auto* Loop = PNP.CtrlPivot();
+  if(Loop->getOp() != IrOpcode::Loop ||
+     Loop->getNumControlInput() != 2)
+    return false;
+
+  // value inputs are in the same order as control inputs of Loop
+  auto* Next = PHI->getValueInput(1);
+  NodeProperties<IrOpcode::VirtBinOps> BNP(Next);
+  if(Next->getOp() != IrOpcode::BinAdd &&
+     Next->getOp() != IrOpcode::BinSub)
+    return false;
+  NodeProperties<IrOpcode::ConstantInt> LNP(BNP.LHS()),
+                                        RNP(BNP.RHS());
+  int32_t Step;
+  if(BNP.LHS() == PHI && RNP) {
+    Step = RNP.as<int32_t>(G);
+    if(Next->getOp() == IrOpcode::BinSub) Step = -Step;
+  } else if(BNP.RHS() == PHI && LNP &&
+            Next->getOp() == IrOpcode::BinAdd) {
+    Step = LNP.as<int32_t>(G);
+  } else {
+    return false;
+  }
+  if(!Step) return false;
+
+  IV.PHI = PHI;
+  IV.Loop = Loop;
+  IV.Init = PHI->getValueInput(0);
+  IV.Next = Next;
+  IV.Step = Step;
+  return true;
+}
+
+bool LoopAnalysis::GetScale(Node* N, const InductionVariable& IV,
+                            int32_t& Scale) {
+  if(N == IV.PHI) {
+    Scale = 1;
+    return true;
+  }
+  if(!IsInLoop(N, IV.Loop)) {
+    Scale = 0;
+    return true;
+  }
+
+  NodeProperties<IrOpcode::VirtBinOps> BNP(N);
+  int32_t LHSScale, RHSScale;
+  switch(N->getOp()) {
+  case IrOpcode::BinAdd:
+  case IrOpcode::BinSub:
+    if(!GetScale(BNP.LHS(), IV, LHSScale) ||
+       !GetScale(BNP.RHS(), IV, RHSScale))
+      return false;
+    Scale = N->getOp() == IrOpcode::BinAdd? LHSScale + RHSScale
+                                          : LHSScale - RHSScale;
+    return true;
+  case IrOpcode::BinMul: {
+    NodeProperties<IrOpcode::ConstantInt> LNP(BNP.LHS()),
+                                          RNP(BNP.RHS());
+    if(!LNP && !RNP) return false;
+    if(!GetScale(RNP? BNP.LHS() : BNP.RHS(), IV, Scale))
+      return false;
+    Scale *= RNP? RNP.as<int32_t>(G) : LNP.as<int32_t>(G);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
@@ -0,0 +1,61 @@
+#include "gross/Graph/Reductions/MemoryAlias.h"
+#include "gross/Graph/NodeUtils.h"
+
+using namespace gross;
+
+MemoryAlias::LinearOffset MemoryAlias::Decompose(Node* Offset) const {
+  if(NodeProperties<IrOpcode::ConstantInt> CNP{Offset})
+    return {nullptr, 1, CNP.as<int32_t>(G)};
+
+  NodeProperties<IrOpcode::VirtBinOps> BNP(Offset);
+  if(!BNP) return {Offset, 1, 0};
+  NodeProperties<IrOpcode::ConstantInt> LNP(BNP.LHS()),
+                                        RNP(BNP.RHS());
+  switch(Offset->getOp()) {
+  case IrOpcode::BinAdd:
+    if(RNP || LNP) {
+      auto LO = Decompose(RNP? BNP.LHS() : BNP.RHS());
+      LO.Const += RNP? RNP.as<int32_t>(G) : LNP.as<int32_t>(G);
+      return LO;
+    }
+    break;
+  case IrOpcode::BinSub:
+    if(RNP) {
+      auto LO = Decompose(BNP.LHS());
+      LO.Const -= RNP.as<int32_t>(G);
+      return LO;
+    }
+    break;
+  case IrOpcode::BinMul:
+    if(RNP || LNP) {
+      auto LO = Decompose(RNP? BNP.LHS() : BNP.RHS());
+      auto Factor = RNP? RNP.as<int32_t>(G) : LNP.as<int32_t>(G);
+      LO.Scale *= Factor;
+      LO.Const *= Factor;
+      return LO;
+    }
+    break;
+  default:
+    break;
+  }
+  return {Offset, 1, 0};
+}
+
+MemoryAlias::Result MemoryAlias::Query(Node* Mem1, Node* Mem2) const {
+  NodeProperties<IrOpcode::VirtMemOps> NP1(Mem1), NP2(Mem2);
+  assert(NP1 && NP2);
+  auto *Base1 = NP1.BaseAddr(), *Base2 = NP2.BaseAddr();
+  if(Base1 != Base2) {
+    // every Alloca is a distinct memory object
+    if(Base1->getOp() == IrOpcode::Alloca &&
+       Base2->getOp() == IrOpcode::Alloca)
+      return NoAlias;
+    return MayAlias;
+  }
+
+  if(NP1.Offset() == NP2.Offset()) return MustAlias;
+  auto LO1 = Decompose(NP1.Offset()), LO2 = Decompose(NP2.Offset());
+  if(LO1.Term != LO2.Term || LO1.Scale != LO2.Scale)
+    return MayAlias;
+  return LO1.Const == LO2.Const? MustAlias : NoAlias;
+}
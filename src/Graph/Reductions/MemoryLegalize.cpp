@@ -103,6 +103,7 @@ void DLXMemoryLegalize::RunOnFunction(SubGraph& SG) {
       LocalAllocas.insert(N);
   }
   (void) MergeAllocas(LocalAllocas);
+  SG.InvalidateNodes();
 }
 
 void DLXMemoryLegalize::Run() {
@@ -119,4 +120,5 @@ void DLXMemoryLegalize::Run() {
   for(auto* GA: GlobalAllocas) {
     G.ReplaceGlobalVar(GA, NewGV);
   }
+  G.InvalidateSubRegions();
 }
@@ -1,5 +1,6 @@
 #include "gross/Graph/Reductions/Peephole.h"
 #include "gross/Graph/NodeUtils.h"
+#include <utility>
 
 using namespace gross;
 
@@ -49,6 +50,32 @@ GraphReduction PeepholeReducer::ReduceArithmetic(Node* N) {
       return NoChange();
     }
   }
+
+  // reassociate (X + C1) + C2 into X + (C1 + C2). Offsets of
+  // memory operations are usually formed in this way
+  if(N->getOp() == IrOpcode::BinAdd) {
+    auto* Inner = NP.LHS();
+    auto* Outer = NP.RHS();
+    if(Inner->getOp() == IrOpcode::ConstantInt) std::swap(Inner, Outer);
+    NodeProperties<IrOpcode::VirtBinOps> INP(Inner);
+    NodeProperties<IrOpcode::ConstantInt> ONP(Outer);
+    if(ONP && Inner->getOp() == IrOpcode::BinAdd) {
+      auto* Val = INP.LHS();
+      auto* InnerConst = INP.RHS();
+      if(Val->getOp() == IrOpcode::ConstantInt) std::swap(Val, InnerConst);
+      NodeProperties<IrOpcode::ConstantInt> CNP(InnerConst);
+      if(CNP && Val->getOp() != IrOpcode::ConstantInt) {
+        auto Sum = CNP.as<int32_t>(G) + ONP.as<int32_t>(G);
+        if(!Sum) return Replace(Val);
+        auto* NewNode
+          = NodeBuilder<IrOpcode::BinAdd>(&G)
+            .LHS(Val)
+            .RHS(NodeBuilder<IrOpcode::ConstantInt>(&G, Sum).Build())
+            .Build();
+        return Replace(NewNode);
+      }
+    }
+  }
   return NoChange();
 }
 
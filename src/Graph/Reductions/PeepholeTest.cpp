@@ -88,6 +88,40 @@ TEST(GRPeepholeUnitTest, ConstReductionTest) {
     EXPECT_EQ(NodeProperties<IrOpcode::ConstantInt>(RNP.ReturnVal())
               .as<int32_t>(G), 65);
   }
+  {
+    // (a + 4) + (-808) => a + (-804)
+    Graph G;
+    auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+    auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+                 .FuncName("func_const_reassociate")
+                 .AddParameter(Arg)
+                 .Build();
+    auto* Const1 = NodeBuilder<IrOpcode::ConstantInt>(&G, 4)
+                   .Build();
+    auto* Const2 = NodeBuilder<IrOpcode::ConstantInt>(&G, -808)
+                   .Build();
+    auto* RHSVal1 = NodeBuilder<IrOpcode::BinAdd>(&G)
+                   .LHS(Arg).RHS(Const1)
+                   .Build();
+    auto* RHSVal2 = NodeBuilder<IrOpcode::BinAdd>(&G)
+                   .LHS(Const2).RHS(RHSVal1)
+                   .Build();
+    auto* Return = NodeBuilder<IrOpcode::Return>(&G, RHSVal2)
+                   .Build();
+    auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+                .AddTerminator(Return)
+                .Build();
+    SubGraph FuncSG(End);
+    G.AddSubRegion(FuncSG);
+    GraphReducer::RunWithEditor<PeepholeReducer>(G);
+
+    NodeProperties<IrOpcode::Return> RNP(Return);
+    ASSERT_EQ(RNP.ReturnVal()->getOp(), IrOpcode::BinAdd);
+    NodeProperties<IrOpcode::VirtBinOps> BNP(RNP.ReturnVal());
+    EXPECT_EQ(BNP.LHS(), Arg);
+    EXPECT_EQ(NodeProperties<IrOpcode::ConstantInt>(BNP.RHS())
+              .as<int32_t>(G), -804);
+  }
 }
 
 TEST(GRPeepholeUnitTest, RelationReductionTest) {
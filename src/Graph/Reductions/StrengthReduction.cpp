@@ -0,0 +1,221 @@
+#include "gross/Graph/Reductions/StrengthReduction.h"
+#include "gross/Graph/NodeUtils.h"
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace gross;
+
+StrengthReductionReducer::StrengthReductionReducer(
+  GraphEditor::Interface* editor)
+  : GraphEditor(editor),
+    G(Editor->GetGraph()),
+    LA(G) {}
+
+Node* StrengthReductionReducer::BuildAdd(Node* LHS, Node* RHS) {
+  NodeProperties<IrOpcode::ConstantInt> LNP(LHS), RNP(RHS);
+  if(LNP && RNP)
+    return NodeBuilder<IrOpcode::ConstantInt>(&G, LNP.as<int32_t>(G) +
+                                                  RNP.as<int32_t>(G))
+           .Build();
+  if(LNP && !LNP.as<int32_t>(G)) return RHS;
+  if(RNP && !RNP.as<int32_t>(G)) return LHS;
+  return NodeBuilder<IrOpcode::BinAdd>(&G)
+         .LHS(LHS).RHS(RHS)
+         .Build();
+}
+
+Node* StrengthReductionReducer::BuildSub(Node* LHS, Node* RHS) {
+  NodeProperties<IrOpcode::ConstantInt> LNP(LHS), RNP(RHS);
+  if(LNP && RNP)
+    return NodeBuilder<IrOpcode::ConstantInt>(&G, LNP.as<int32_t>(G) -
+                                                  RNP.as<int32_t>(G))
+           .Build();
+  if(RNP && !RNP.as<int32_t>(G)) return LHS;
+  return NodeBuilder<IrOpcode::BinSub>(&G)
+         .LHS(LHS).RHS(RHS)
+         .Build();
+}
+
+Node* StrengthReductionReducer::BuildMul(Node* LHS, int32_t Factor) {
+  NodeProperties<IrOpcode::ConstantInt> LNP(LHS);
+  if(LNP)
+    return NodeBuilder<IrOpcode::ConstantInt>(&G,
+                                              LNP.as<int32_t>(G) * Factor)
+           .Build();
+  if(!Factor)
+    return NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  if(Factor == 1) return LHS;
+  auto* FactorNode = NodeBuilder<IrOpcode::ConstantInt>(&G, Factor).Build();
+  return NodeBuilder<IrOpcode::BinMul>(&G)
+         .LHS(LHS).RHS(FactorNode)
+         .Build();
+}
+
+Node* StrengthReductionReducer::GetRest(
+  Node* N, const LoopAnalysis::InductionVariable& IV,
+  std::map<Node*, Node*>& Rests) {
+  if(N == IV.PHI)
+    return NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  if(!LA.IsInLoop(N, IV.Loop)) return N;
+  if(Rests.count(N)) return Rests.at(N);
+
+  NodeProperties<IrOpcode::VirtBinOps> BNP(N);
+  Node* Rest = nullptr;
+  switch(N->getOp()) {
+  case IrOpcode::BinAdd:
+    Rest = BuildAdd(GetRest(BNP.LHS(), IV, Rests),
+                    GetRest(BNP.RHS(), IV, Rests));
+    break;
+  case IrOpcode::BinSub:
+    Rest = BuildSub(GetRest(BNP.LHS(), IV, Rests),
+                    GetRest(BNP.RHS(), IV, Rests));
+    break;
+  case IrOpcode::BinMul: {
+    NodeProperties<IrOpcode::ConstantInt> LNP(BNP.LHS()),
+                                          RNP(BNP.RHS());
+    assert(LNP || RNP);
+    Rest = BuildMul(GetRest(RNP? BNP.LHS() : BNP.RHS(), IV, Rests),
+                    RNP? RNP.as<int32_t>(G) : LNP.as<int32_t>(G));
+    break;
+  }
+  default:
+    gross_unreachable("Not an affine function of induction variable");
+  }
+  return Rests[N] = Rest;
+}
+
+Node* StrengthReductionReducer::GetDerivedIV(
+  const LoopAnalysis::InductionVariable& IV,
+  int32_t Scale, derived_map& DerivedIVs) {
+  if(DerivedIVs.count(Scale)) return DerivedIVs.at(Scale);
+
+  auto* Init = BuildMul(IV.Init, Scale);
+  auto* PHI = NodeBuilder<IrOpcode::Phi>(&G)
+              .SetCtrlMerge(IV.Loop)
+              .AddValueInput(Init).AddValueInput(Init)
+              .Build();
+  auto* Step = NodeBuilder<IrOpcode::ConstantInt>(&G, IV.Step * Scale)
+               .Build();
+  auto* Next = NodeBuilder<IrOpcode::BinAdd>(&G)
+               .LHS(PHI).RHS(Step)
+               .Build();
+  PHI->setValueInput(1, Next);
+  return DerivedIVs[Scale] = PHI;
+}
+
+// relations are compared against zero after Peephole
+static bool IsZeroTest(Node* N, Node* Val, const Graph& G) {
+  switch(N->getOp()) {
+  case IrOpcode::BinLe:
+  case IrOpcode::BinLt:
+  case IrOpcode::BinGe:
+  case IrOpcode::BinGt:
+  case IrOpcode::BinEq:
+  case IrOpcode::BinNe: {
+    NodeProperties<IrOpcode::VirtBinOps> BNP(N);
+    NodeProperties<IrOpcode::ConstantInt> RNP(BNP.RHS());
+    return BNP.LHS() == Val && RNP && !RNP.as<int32_t>(G);
+  }
+  default:
+    return false;
+  }
+}
+
+bool StrengthReductionReducer::IsExitTest(
+  Node* N, Node* Val, const LoopAnalysis::InductionVariable& IV) {
+  int32_t Scale;
+  if(!LA.GetScale(Val, IV, Scale) || Scale != 1) return false;
+  if(IsZeroTest(N, Val, G)) return true;
+
+  if(N->getOp() != IrOpcode::BinSub) return false;
+  NodeProperties<IrOpcode::VirtBinOps> BNP(N);
+  auto* Bound = BNP.LHS() == Val? BNP.RHS() : BNP.LHS();
+  if(Bound == Val || LA.IsInLoop(Bound, IV.Loop)) return false;
+  for(auto* U : N->users()) {
+    if(!IsZeroTest(U, N, G)) return false;
+  }
+  return true;
+}
+
+GraphReduction StrengthReductionReducer::ReducePhiNode(Node* N) {
+  LoopAnalysis::InductionVariable IV;
+  if(!LA.GetInductionVariable(N, IV)) return NoChange();
+
+  // find all the nodes in the form of i * Scale + Rest,
+  // and make sure none of them escapes
+  std::set<Node*> Affine{N};
+  std::vector<Node*> Worklist{N};
+  // {user, the affine node it uses}
+  std::vector<std::pair<Node*, Node*>> MemOps, Tests;
+  int32_t TestScale = 0;
+  while(!Worklist.empty()) {
+    auto* Val = Worklist.back();
+    Worklist.pop_back();
+    for(auto* U : Val->users()) {
+      if(Affine.count(U)) continue;
+      int32_t Scale;
+      if(NodeProperties<IrOpcode::VirtMemOps> MNP{U}) {
+        if(MNP.Offset() != Val || MNP.BaseAddr() == Val ||
+           (U->getOp() == IrOpcode::MemStore &&
+            NodeProperties<IrOpcode::MemStore>(U).SrcVal() == Val))
+          return NoChange();
+        LA.GetScale(Val, IV, Scale);
+        // multiplications on i can be saved
+        if(Scale > 1 && !TestScale) TestScale = Scale;
+        MemOps.push_back(std::make_pair(U, Val));
+      } else if(IsExitTest(U, Val, IV)) {
+        Tests.push_back(std::make_pair(U, Val));
+      } else if((U->getOp() == IrOpcode::BinAdd ||
+                 U->getOp() == IrOpcode::BinSub ||
+                 U->getOp() == IrOpcode::BinMul) &&
+                LA.GetScale(U, IV, Scale)) {
+        Affine.insert(U);
+        Worklist.push_back(U);
+      } else {
+        return NoChange();
+      }
+    }
+  }
+  if(!TestScale) return NoChange();
+
+  derived_map DerivedIVs;
+  std::map<Node*, Node*> Rests;
+  for(auto& Pair : MemOps) {
+    auto* Mem = Pair.first;
+    auto* Offset = Pair.second;
+    int32_t Scale;
+    LA.GetScale(Offset, IV, Scale);
+    auto* NewOffset = GetRest(Offset, IV, Rests);
+    if(Scale)
+      NewOffset = BuildAdd(GetDerivedIV(IV, Scale, DerivedIVs), NewOffset);
+    Mem->ReplaceUseOfWith(Offset, NewOffset, Use::K_VALUE);
+  }
+
+  // i + Rest <> Bound  =>  p <> (Bound - Rest) * Scale
+  auto* DerivedIV = GetDerivedIV(IV, TestScale, DerivedIVs);
+  for(auto& Pair : Tests) {
+    auto* Test = Pair.first;
+    auto* Val = Pair.second;
+    auto* Rest = GetRest(Val, IV, Rests);
+    if(Test->getOp() == IrOpcode::BinSub) {
+      NodeProperties<IrOpcode::VirtBinOps> BNP(Test);
+      auto* Bound = BNP.LHS() == Val? BNP.RHS() : BNP.LHS();
+      auto* NewBound = BuildMul(BuildSub(Bound, Rest), TestScale);
+      Test->ReplaceUseOfWith(Val, DerivedIV, Use::K_VALUE);
+      if(NewBound != Bound)
+        Test->ReplaceUseOfWith(Bound, NewBound, Use::K_VALUE);
+    } else {
+      auto* NewVal = BuildAdd(DerivedIV, BuildMul(Rest, TestScale));
+      Test->ReplaceUseOfWith(Val, NewVal, Use::K_VALUE);
+    }
+  }
+  // i is dead now
+  return Replace(N);
+}
+
+GraphReduction StrengthReductionReducer::Reduce(Node* N) {
+  if(N->getOp() == IrOpcode::Phi)
+    return ReducePhiNode(N);
+  return NoChange();
+}
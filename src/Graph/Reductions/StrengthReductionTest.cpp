@@ -0,0 +1,185 @@
+#include "gross/Graph/Reductions/StrengthReduction.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gtest/gtest.h"
+#include <fstream>
+
+using namespace gross;
+
+TEST(GRStrengthReductionUnitTest, ArrayOffsetTest) {
+  // i <- 0; while i < n do a[i] <- a[i + 1]; i <- i + 1 od
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "n").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_strength_reduction")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* One = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Size = NodeBuilder<IrOpcode::ConstantInt>(&G, 40).Build();
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Size).Build();
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(Arg).Build();
+
+  // i - n, the LHS will be replaced by i later
+  auto* Test = NodeBuilder<IrOpcode::BinSub>(&G)
+               .LHS(Arg).RHS(Arg)
+               .Build();
+  auto* Cond = NodeBuilder<IrOpcode::BinLt>(&G)
+               .LHS(Test).RHS(Zero)
+               .Build();
+  auto* Loop = NodeBuilder<IrOpcode::Loop>(&G, Func)
+               .Condition(Cond)
+               .Build();
+  auto* PHI = NodeBuilder<IrOpcode::Phi>(&G)
+              .SetCtrlMerge(Loop)
+              .AddValueInput(Zero).AddValueInput(Zero)
+              .Build();
+  auto* Inc = NodeBuilder<IrOpcode::BinAdd>(&G)
+              .LHS(PHI).RHS(One)
+              .Build();
+  PHI->setValueInput(1, Inc);
+  Test->setValueInput(0, PHI);
+  auto* EffectPHI = NodeBuilder<IrOpcode::Phi>(&G)
+                    .SetCtrlMerge(Loop)
+                    .AddEffectInput(Store1).AddEffectInput(Store1)
+                    .Build();
+
+  auto* Offset1 = NodeBuilder<IrOpcode::BinMul>(&G)
+                  .LHS(Inc).RHS(Four)
+                  .Build();
+  auto* Load = NodeBuilder<IrOpcode::MemLoad>(&G)
+               .BaseAddr(Alloca).Offset(Offset1)
+               .Build();
+  Load->appendEffectInput(EffectPHI);
+  auto* Offset2 = NodeBuilder<IrOpcode::BinMul>(&G)
+                  .LHS(PHI).RHS(Four)
+                  .Build();
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Offset2)
+                 .Src(Load).Build();
+  Store2->appendEffectInput(Load);
+  EffectPHI->setEffectInput(1, Store2);
+
+  auto* RetVal = NodeBuilder<IrOpcode::MemLoad>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Build();
+  RetVal->appendEffectInput(EffectPHI);
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+  {
+    std::ofstream OF("TestStrengthReduction.dot");
+    G.dumpGraphviz(OF);
+  }
+
+  GraphReducer::RunWithEditor<StrengthReductionReducer>(G);
+  {
+    std::ofstream OF("TestStrengthReduction.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  // p <- PHI(0, p + 4)
+  NodeProperties<IrOpcode::MemStore> SNP(Store2);
+  auto* NewPHI = SNP.Offset();
+  ASSERT_EQ(NewPHI->getOp(), IrOpcode::Phi);
+  EXPECT_EQ(NodeProperties<IrOpcode::Phi>(NewPHI).CtrlPivot(), Loop);
+  ASSERT_EQ(NewPHI->getNumValueInput(), 2);
+  EXPECT_EQ(NodeProperties<IrOpcode::ConstantInt>(NewPHI->getValueInput(0))
+            .as<int32_t>(G), 0);
+  auto* NewInc = NewPHI->getValueInput(1);
+  ASSERT_EQ(NewInc->getOp(), IrOpcode::BinAdd);
+  NodeProperties<IrOpcode::VirtBinOps> IncNP(NewInc);
+  EXPECT_EQ(IncNP.LHS(), NewPHI);
+  EXPECT_EQ(NodeProperties<IrOpcode::ConstantInt>(IncNP.RHS())
+            .as<int32_t>(G), 4);
+
+  // a[i + 1] => p + 4
+  auto* NewOffset = NodeProperties<IrOpcode::MemLoad>(Load).Offset();
+  ASSERT_EQ(NewOffset->getOp(), IrOpcode::BinAdd);
+  NodeProperties<IrOpcode::VirtBinOps> OffsetNP(NewOffset);
+  EXPECT_EQ(OffsetNP.LHS(), NewPHI);
+  EXPECT_EQ(NodeProperties<IrOpcode::ConstantInt>(OffsetNP.RHS())
+            .as<int32_t>(G), 4);
+
+  // i - n => p - n * 4
+  NodeProperties<IrOpcode::VirtBinOps> TestNP(Test);
+  EXPECT_EQ(TestNP.LHS(), NewPHI);
+  auto* Bound = TestNP.RHS();
+  ASSERT_EQ(Bound->getOp(), IrOpcode::BinMul);
+  EXPECT_EQ(NodeProperties<IrOpcode::VirtBinOps>(Bound).LHS(), Arg);
+}
+
+TEST(GRStrengthReductionUnitTest, EscapedIVTest) {
+  // i <- 0; while i < n do a[i] <- i; i <- i + 1 od
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "n").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_strength_reduction_escaped")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* One = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Size = NodeBuilder<IrOpcode::ConstantInt>(&G, 40).Build();
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Size).Build();
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(Arg).Build();
+
+  auto* Test = NodeBuilder<IrOpcode::BinSub>(&G)
+               .LHS(Arg).RHS(Arg)
+               .Build();
+  auto* Cond = NodeBuilder<IrOpcode::BinLt>(&G)
+               .LHS(Test).RHS(Zero)
+               .Build();
+  auto* Loop = NodeBuilder<IrOpcode::Loop>(&G, Func)
+               .Condition(Cond)
+               .Build();
+  auto* PHI = NodeBuilder<IrOpcode::Phi>(&G)
+              .SetCtrlMerge(Loop)
+              .AddValueInput(Zero).AddValueInput(Zero)
+              .Build();
+  auto* Inc = NodeBuilder<IrOpcode::BinAdd>(&G)
+              .LHS(PHI).RHS(One)
+              .Build();
+  PHI->setValueInput(1, Inc);
+  Test->setValueInput(0, PHI);
+  auto* EffectPHI = NodeBuilder<IrOpcode::Phi>(&G)
+                    .SetCtrlMerge(Loop)
+                    .AddEffectInput(Store1).AddEffectInput(Store1)
+                    .Build();
+
+  auto* Offset = NodeBuilder<IrOpcode::BinMul>(&G)
+                 .LHS(PHI).RHS(Four)
+                 .Build();
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Offset)
+                 .Src(PHI).Build();
+  Store2->appendEffectInput(EffectPHI);
+  EffectPHI->setEffectInput(1, Store2);
+
+  auto* RetVal = NodeBuilder<IrOpcode::MemLoad>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Build();
+  RetVal->appendEffectInput(EffectPHI);
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+
+  // i is still needed by the stored value, so
+  // a new induction variable only adds register pressure
+  EXPECT_EQ(GraphReducer::RunWithEditor<StrengthReductionReducer>(G), 0U);
+  EXPECT_EQ(NodeProperties<IrOpcode::MemStore>(Store2).Offset(), Offset);
+  EXPECT_EQ(NodeProperties<IrOpcode::VirtBinOps>(Test).LHS(), PHI);
+}
@@ -1,5 +1,6 @@
 #include "gross/Graph/Reductions/ValuePromotion.h"
 #include "gross/Graph/NodeUtils.h"
+#include <set>
 #include <vector>
 
 using namespace gross;
@@ -241,3 +242,187 @@ GraphReduction ValuePromotion::Reduce(Node* N) {
     return NoChange();
   }
 }
+
+/// ===== ArrayPromotion =====
+// arrays larger than this are left in memory
+static constexpr int32_t MaxPromotedElements = 16;
+
+ArrayPromotion::ArrayPromotion(GraphEditor::Interface* editor)
+  : GraphEditor(editor),
+    G(Editor->GetGraph()),
+    ZeroNode(NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build()) {}
+
+bool ArrayPromotion::CollectMemoryNodes(Node* Alloca,
+                                        std::vector<Node*>& Nodes) {
+  int32_t Size = NodeProperties<IrOpcode::ConstantInt>(
+                   NodeProperties<IrOpcode::Alloca>(Alloca).Size())
+                 .as<int32_t>(G);
+  auto isValidAccess = [&,this](Node* N) -> bool {
+    NodeProperties<IrOpcode::VirtMemOps> MNP(N);
+    if(!MNP || MNP.BaseAddr() != Alloca) return false;
+    if(N->getOp() == IrOpcode::MemStore &&
+       NodeProperties<IrOpcode::MemStore>(N).SrcVal() == Alloca)
+      return false;
+    NodeProperties<IrOpcode::ConstantInt> CNP(MNP.Offset());
+    if(!CNP) return false;
+    auto Offset = CNP.as<int32_t>(G);
+    return Offset >= 0 && Offset < Size && Offset % 4 == 0;
+  };
+
+  std::set<Node*> Visited;
+  std::vector<Node*> Worklist;
+  if(Alloca->user_size() != Alloca->user_size(Use::K_VALUE))
+    return false;
+  for(auto* VU : Alloca->value_users()) {
+    if(VU->getOp() != IrOpcode::SrcInitialArray &&
+       !isValidAccess(VU))
+      return false;
+    if(Visited.insert(VU).second) Worklist.push_back(VU);
+  }
+
+  while(!Worklist.empty()) {
+    auto* N = Worklist.back();
+    Worklist.pop_back();
+    switch(N->getOp()) {
+    case IrOpcode::MemLoad:
+    case IrOpcode::MemStore:
+      if(!isValidAccess(N)) return false;
+      break;
+    case IrOpcode::SrcInitialArray:
+      if(N->getValueInput(0) != Alloca) return false;
+      break;
+    case IrOpcode::Phi:
+      // PHIs of other variables are not involved
+      if(N->getNumValueInput() || N->getNumControlInput() != 1)
+        return false;
+      break;
+    case IrOpcode::EffectMerge:
+      break;
+    default:
+      return false;
+    }
+    Nodes.push_back(N);
+
+    for(auto* EI : N->effect_inputs()) {
+      if(Visited.insert(EI).second) Worklist.push_back(EI);
+    }
+    for(auto* EU : N->effect_users()) {
+      // nothing is observable after the function returns
+      if(EU->getOp() == IrOpcode::End) continue;
+      if(Visited.insert(EU).second) Worklist.push_back(EU);
+    }
+  }
+  return true;
+}
+
+Node* ArrayPromotion::GetElementValue(Node* State, Node* Offset,
+                                      value_cache_type& Cache,
+                                      std::vector<Node*>& NewPHIs) {
+  auto Key = std::make_pair(State, Offset);
+  if(Cache.count(Key)) return Cache.at(Key);
+
+  Node* Val = nullptr;
+  switch(State->getOp()) {
+  case IrOpcode::MemStore:
+  case IrOpcode::MemLoad:
+  case IrOpcode::EffectMerge:
+    if(State->getOp() == IrOpcode::MemStore &&
+       NodeProperties<IrOpcode::MemStore>(State).Offset() == Offset)
+      Val = NodeProperties<IrOpcode::MemStore>(State).SrcVal();
+    // all the effect inputs share the same memory state
+    else if(State->getNumEffectInput())
+      Val = GetElementValue(State->getEffectInput(0), Offset,
+                            Cache, NewPHIs);
+    else
+      Val = ZeroNode;
+    break;
+  case IrOpcode::Phi: {
+    // insert the PHI first to break the cycles on backedges
+    NodeBuilder<IrOpcode::Phi> PB(&G);
+    PB.SetCtrlMerge(State->getControlInput(0));
+    for(unsigned i = 0, N = State->getNumEffectInput(); i < N; ++i)
+      PB.AddValueInput(ZeroNode);
+    auto* PHI = PB.Build();
+    Cache[Key] = PHI;
+    NewPHIs.push_back(PHI);
+    for(unsigned i = 0, N = State->getNumEffectInput(); i < N; ++i) {
+      auto* EI = State->getEffectInput(i);
+      PHI->setValueInput(i, GetElementValue(EI, Offset, Cache, NewPHIs));
+    }
+    return PHI;
+  }
+  default:
+    // initial state of local arrays
+    Val = ZeroNode;
+    break;
+  }
+  Cache[Key] = Val;
+  return Val;
+}
+
+// PHIs whose inputs are all the same value except themselves
+void ArrayPromotion::RemoveTrivialPHIs(std::vector<Node*>& PHIs) {
+  bool Changed;
+  do {
+    Changed = false;
+    for(auto* PHI : PHIs) {
+      if(!PHI->user_size()) continue;
+      Node* Val = nullptr;
+      bool IsTrivial = true;
+      for(auto* VI : PHI->value_inputs()) {
+        if(VI == PHI || VI == Val) continue;
+        if(Val) {
+          IsTrivial = false;
+          break;
+        }
+        Val = VI;
+      }
+      if(!IsTrivial || !Val) continue;
+      PHI->ReplaceWith(Val, Use::K_VALUE);
+      Changed = true;
+    }
+  } while(Changed);
+}
+
+GraphReduction ArrayPromotion::ReduceAlloca(Node* Alloca) {
+  if(G.IsGlobalVar(Alloca)) return NoChange();
+  NodeProperties<IrOpcode::ConstantInt>
+    SizeNP(NodeProperties<IrOpcode::Alloca>(Alloca).Size());
+  if(!SizeNP) return NoChange();
+  auto NumElements = SizeNP.as<int32_t>(G) / 4;
+  if(NumElements <= 0 || NumElements > MaxPromotedElements)
+    return NoChange();
+
+  std::vector<Node*> MemNodes;
+  if(!CollectMemoryNodes(Alloca, MemNodes)) return NoChange();
+
+  value_cache_type Cache;
+  std::vector<Node*> NewPHIs;
+  for(auto* N : MemNodes) {
+    if(N->getOp() != IrOpcode::MemLoad) continue;
+    auto* Offset = NodeProperties<IrOpcode::MemLoad>(N).Offset();
+    auto* Val = N->getNumEffectInput()?
+                GetElementValue(N->getEffectInput(0), Offset,
+                                Cache, NewPHIs) :
+                ZeroNode;
+    N->ReplaceWith(Val, Use::K_VALUE);
+  }
+  RemoveTrivialPHIs(NewPHIs);
+
+  // detach the effect chains so they will be trimmed
+  for(auto* N : MemNodes) {
+    std::vector<Node*> EffectUsers(N->effect_users().begin(),
+                                   N->effect_users().end());
+    for(auto* EU : EffectUsers) {
+      if(EU->getOp() == IrOpcode::End)
+        EU->removeEffectInputAll(N);
+    }
+  }
+  return Replace(Alloca);
+}
+
+GraphReduction ArrayPromotion::Reduce(Node* N) {
+  if(N->getOp() == IrOpcode::Alloca)
+    return ReduceAlloca(N);
+  return NoChange();
+}
@@ -280,3 +280,86 @@ TEST(GRValuePromotionUnitTest, ArrayWriteTest) {
     }
   }
 }
+
+TEST(GRValuePromotionUnitTest, ArrayPromotionTest) {
+  Graph G;
+  auto* Arg = NodeBuilder<IrOpcode::Argument>(&G, "a").Build();
+  auto* Func = NodeBuilder<IrOpcode::VirtFuncPrototype>(&G)
+               .FuncName("func_array_promotion")
+               .AddParameter(Arg)
+               .Build();
+  auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+  auto* One = NodeBuilder<IrOpcode::ConstantInt>(&G, 1).Build();
+  auto* Four = NodeBuilder<IrOpcode::ConstantInt>(&G, 4).Build();
+  auto* Eight = NodeBuilder<IrOpcode::ConstantInt>(&G, 8).Build();
+
+  auto* Alloca = NodeBuilder<IrOpcode::Alloca>(&G)
+                 .Size(Eight).Build();
+  auto* InitState = NodeBuilder<IrOpcode::SrcInitialArray>(&G, Alloca)
+                    .Build();
+  // a[0] <- arg
+  auto* Store1 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Zero)
+                 .Src(Arg).Build();
+  Store1->appendEffectInput(InitState);
+  auto* IfBranch = NodeBuilder<IrOpcode::If>(&G)
+                   .Condition(Arg).Build();
+  auto* IfTrue = NodeBuilder<IrOpcode::VirtIfBranches>(&G, true)
+                 .IfStmt(IfBranch)
+                 .Build();
+  auto* IfFalse = NodeBuilder<IrOpcode::VirtIfBranches>(&G, false)
+                  .IfStmt(IfBranch)
+                  .Build();
+  // if arg then a[1] <- 1 fi
+  auto* Store2 = NodeBuilder<IrOpcode::MemStore>(&G)
+                 .BaseAddr(Alloca).Offset(Four)
+                 .Src(One).Build();
+  Store2->appendEffectInput(Store1);
+  auto* Merge = NodeBuilder<IrOpcode::Merge>(&G)
+                .AddCtrlInput(IfTrue).AddCtrlInput(IfFalse)
+                .Build();
+  auto* EffectPHI = NodeBuilder<IrOpcode::Phi>(&G)
+                    .SetCtrlMerge(Merge)
+                    .AddEffectInput(Store2)
+                    .AddEffectInput(Store1)
+                    .Build();
+  // return a[0] + a[1]
+  auto* Load1 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Zero)
+                .Build();
+  Load1->appendEffectInput(EffectPHI);
+  auto* Load2 = NodeBuilder<IrOpcode::MemLoad>(&G)
+                .BaseAddr(Alloca).Offset(Four)
+                .Build();
+  Load2->appendEffectInput(EffectPHI);
+  auto* RetVal = NodeBuilder<IrOpcode::BinAdd>(&G)
+                 .LHS(Load1).RHS(Load2)
+                 .Build();
+  auto* Return = NodeBuilder<IrOpcode::Return>(&G, RetVal)
+                 .Build();
+  auto* End = NodeBuilder<IrOpcode::End>(&G, Func)
+              .AddTerminator(Return)
+              .Build();
+  SubGraph FuncSG(End);
+  G.AddSubRegion(FuncSG);
+
+  GraphReducer::RunWithEditor<ArrayPromotion>(G);
+  {
+    std::ofstream OF("TestArrayPromotion.after.dot");
+    G.dumpGraphviz(OF);
+  }
+  NodeProperties<IrOpcode::VirtBinOps> BNP(RetVal);
+  // PHI on a[0] is trivial
+  EXPECT_EQ(BNP.LHS(), Arg);
+  auto* ValuePHI = BNP.RHS();
+  ASSERT_EQ(ValuePHI->getOp(), IrOpcode::Phi);
+  EXPECT_EQ(NodeProperties<IrOpcode::Phi>(ValuePHI).CtrlPivot(), Merge);
+  ASSERT_EQ(ValuePHI->getNumValueInput(), 2);
+  EXPECT_EQ(ValuePHI->getValueInput(0), One);
+  // a[1] is zero-initialized
+  EXPECT_EQ(ValuePHI->getValueInput(1), Zero);
+  for(auto* N : FuncSG.nodes()) {
+    EXPECT_NE(N->getOp(), IrOpcode::MemLoad);
+    EXPECT_NE(N->getOp(), IrOpcode::MemStore);
+  }
+}
@@ -0,0 +1,229 @@
+#include "gross/Support/SmallVector.h"
+#include "gtest/gtest.h"
+#include <utility>
+#include <vector>
+
+using namespace gross;
+
+namespace {
+template<class T, unsigned N>
+std::vector<T> toStdVector(const SmallVector<T, N>& SV) {
+  return std::vector<T>(SV.begin(), SV.end());
+}
+
+// Whether the elements are stored inside the object itself
+template<class T, unsigned N>
+bool isInline(const SmallVector<T, N>& SV) {
+  auto* Obj = reinterpret_cast<const char*>(&SV);
+  auto* Data = reinterpret_cast<const char*>(SV.begin());
+  return Data >= Obj && Data < Obj + sizeof(SV);
+}
+} // end anonymous namespace
+
+TEST(SmallVectorUnitTest, TestInlineToHeapGrowth) {
+  SmallVector<int, 4> SV;
+  EXPECT_TRUE(SV.empty());
+  EXPECT_EQ(SV.capacity(), 4);
+  EXPECT_TRUE(isInline(SV));
+
+  for(int i = 0; i < 4; ++i) SV.push_back(i);
+  EXPECT_EQ(SV.size(), 4);
+  EXPECT_EQ(SV.capacity(), 4);
+  EXPECT_TRUE(isInline(SV));
+
+  SV.push_back(4);
+  EXPECT_EQ(SV.size(), 5);
+  EXPECT_GE(SV.capacity(), 5);
+  EXPECT_FALSE(isInline(SV));
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 1, 2, 3, 4}));
+
+  // pushing an element of itself while growing
+  SmallVector<int, 2> SV2{7, 8};
+  SV2.push_back(SV2[0]);
+  EXPECT_EQ(toStdVector(SV2), (std::vector<int>{7, 8, 7}));
+
+  SmallVector<int, 2> SV3;
+  SV3.resize(5, 9);
+  EXPECT_EQ(toStdVector(SV3), (std::vector<int>(5, 9)));
+  SV3.resize(1);
+  EXPECT_EQ(toStdVector(SV3), (std::vector<int>{9}));
+}
+
+TEST(SmallVectorUnitTest, TestInsert) {
+  SmallVector<int, 4> SV{1, 2, 3};
+
+  // front
+  auto It = SV.insert(SV.begin(), 0);
+  EXPECT_EQ(It, SV.begin());
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_TRUE(isInline(SV));
+
+  // middle, which also triggers growth
+  It = SV.insert(SV.begin() + 2, 10);
+  EXPECT_EQ(*It, 10);
+  EXPECT_EQ(It - SV.begin(), 2);
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 1, 10, 2, 3}));
+  EXPECT_FALSE(isInline(SV));
+
+  // end
+  It = SV.insert(SV.end(), 20);
+  EXPECT_EQ(It, SV.end() - 1);
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 1, 10, 2, 3, 20}));
+
+  // range insertion
+  std::vector<int> Range{100, 101};
+  SmallVector<int, 4> SV2{1, 2};
+  SV2.insert(SV2.begin(), Range.begin(), Range.end());
+  EXPECT_EQ(toStdVector(SV2), (std::vector<int>{100, 101, 1, 2}));
+  SV2.insert(SV2.begin() + 3, Range.begin(), Range.end());
+  EXPECT_EQ(toStdVector(SV2),
+            (std::vector<int>{100, 101, 1, 100, 101, 2}));
+  SV2.insert(SV2.end(), Range.begin(), Range.end());
+  EXPECT_EQ(toStdVector(SV2),
+            (std::vector<int>{100, 101, 1, 100, 101, 2, 100, 101}));
+}
+
+TEST(SmallVectorUnitTest, TestSelfReferencingRange) {
+  // appending itself grows beyond the inline storage
+  SmallVector<int, 4> SV{0, 1, 2};
+  SV.append(SV.begin(), SV.end());
+  EXPECT_FALSE(isInline(SV));
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 1, 2, 0, 1, 2}));
+  SV.append(SV.begin() + 4, SV.end());
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 1, 2, 0, 1, 2, 1, 2}));
+
+  // elements after Pos are shifted before being copied
+  SmallVector<int, 4> SV2{0, 1, 2};
+  SV2.insert(SV2.begin() + 1, SV2.begin(), SV2.end());
+  EXPECT_FALSE(isInline(SV2));
+  EXPECT_EQ(toStdVector(SV2), (std::vector<int>{0, 0, 1, 2, 1, 2}));
+  SV2.insert(SV2.begin(), SV2.end() - 2, SV2.end());
+  EXPECT_EQ(toStdVector(SV2),
+            (std::vector<int>{1, 2, 0, 0, 1, 2, 1, 2}));
+}
+
+TEST(SmallVectorUnitTest, TestErase) {
+  SmallVector<int, 2> SV{0, 1, 2, 3, 4, 5};
+
+  // front
+  auto It = SV.erase(SV.begin());
+  EXPECT_EQ(It, SV.begin());
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{1, 2, 3, 4, 5}));
+
+  // middle
+  It = SV.erase(SV.begin() + 2);
+  EXPECT_EQ(*It, 4);
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{1, 2, 4, 5}));
+
+  // end
+  It = SV.erase(SV.end() - 1);
+  EXPECT_EQ(It, SV.end());
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{1, 2, 4}));
+
+  // ranges
+  SmallVector<int, 2> SV2{0, 1, 2, 3, 4, 5, 6};
+  It = SV2.erase(SV2.begin(), SV2.begin() + 2);
+  EXPECT_EQ(It, SV2.begin());
+  EXPECT_EQ(toStdVector(SV2), (std::vector<int>{2, 3, 4, 5, 6}));
+  It = SV2.erase(SV2.begin() + 1, SV2.begin() + 3);
+  EXPECT_EQ(*It, 5);
+  EXPECT_EQ(toStdVector(SV2), (std::vector<int>{2, 5, 6}));
+  It = SV2.erase(SV2.begin() + 1, SV2.end());
+  EXPECT_EQ(It, SV2.end());
+  EXPECT_EQ(toStdVector(SV2), (std::vector<int>{2}));
+  SV2.erase(SV2.begin(), SV2.begin());
+  EXPECT_EQ(toStdVector(SV2), (std::vector<int>{2}));
+}
+
+TEST(SmallVectorUnitTest, TestMoveInline) {
+  SmallVector<int, 4> SV{1, 2, 3};
+  SmallVector<int, 4> Moved(std::move(SV));
+  EXPECT_TRUE(isInline(Moved));
+  EXPECT_EQ(toStdVector(Moved), (std::vector<int>{1, 2, 3}));
+  EXPECT_TRUE(SV.empty());
+
+  // assign to a heap-allocated one
+  SmallVector<int, 4> Dst{9, 9, 9, 9, 9, 9};
+  EXPECT_FALSE(isInline(Dst));
+  Dst = std::move(Moved);
+  EXPECT_EQ(toStdVector(Dst), (std::vector<int>{1, 2, 3}));
+  EXPECT_TRUE(Moved.empty());
+
+  // assign to an inline one
+  SmallVector<int, 4> Src{4, 5};
+  SmallVector<int, 4> Dst2{7};
+  Dst2 = std::move(Src);
+  EXPECT_TRUE(isInline(Dst2));
+  EXPECT_EQ(toStdVector(Dst2), (std::vector<int>{4, 5}));
+  EXPECT_TRUE(Src.empty());
+
+  // self assignment
+  auto& Self = Dst2;
+  Dst2 = std::move(Self);
+  EXPECT_EQ(toStdVector(Dst2), (std::vector<int>{4, 5}));
+}
+
+TEST(SmallVectorUnitTest, TestMoveHeap) {
+  SmallVector<int, 2> SV{1, 2, 3, 4};
+  EXPECT_FALSE(isInline(SV));
+  const int* Buffer = SV.begin();
+
+  SmallVector<int, 2> Moved(std::move(SV));
+  // heap buffer is stolen rather than copied
+  EXPECT_EQ(Moved.begin(), Buffer);
+  EXPECT_EQ(toStdVector(Moved), (std::vector<int>{1, 2, 3, 4}));
+  EXPECT_TRUE(SV.empty());
+  EXPECT_TRUE(isInline(SV));
+  EXPECT_EQ(SV.capacity(), 2);
+
+  // moved-from object is still usable
+  SV.push_back(5);
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{5}));
+
+  // assign to an inline one
+  SmallVector<int, 2> Dst{8};
+  Dst = std::move(Moved);
+  EXPECT_EQ(Dst.begin(), Buffer);
+  EXPECT_EQ(toStdVector(Dst), (std::vector<int>{1, 2, 3, 4}));
+  EXPECT_TRUE(Moved.empty());
+  EXPECT_TRUE(isInline(Moved));
+
+  // assign to a heap-allocated one
+  SmallVector<int, 2> Dst2{6, 6, 6};
+  EXPECT_FALSE(isInline(Dst2));
+  Dst2 = std::move(Dst);
+  EXPECT_EQ(Dst2.begin(), Buffer);
+  EXPECT_EQ(toStdVector(Dst2), (std::vector<int>{1, 2, 3, 4}));
+  EXPECT_TRUE(Dst.empty());
+}
+
+TEST(SmallVectorUnitTest, TestShrinkToFit) {
+  SmallVector<int, 4> SV{0, 1, 2, 3, 4, 5};
+  EXPECT_FALSE(isInline(SV));
+
+  // still doesn't fit inline storage
+  SV.shrink_to_fit();
+  EXPECT_FALSE(isInline(SV));
+
+  SV.erase(SV.begin() + 1, SV.begin() + 4);
+  SV.shrink_to_fit();
+  EXPECT_TRUE(isInline(SV));
+  EXPECT_EQ(SV.capacity(), 4);
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 4, 5}));
+
+  // no-op on inline storage
+  SV.shrink_to_fit();
+  EXPECT_TRUE(isInline(SV));
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 4, 5}));
+
+  // and it can grow again
+  SV.push_back(6);
+  SV.push_back(7);
+  EXPECT_FALSE(isInline(SV));
+  EXPECT_EQ(toStdVector(SV), (std::vector<int>{0, 4, 5, 6, 7}));
+
+  SV.clear();
+  SV.shrink_to_fit();
+  EXPECT_TRUE(isInline(SV));
+  EXPECT_TRUE(SV.empty());
+}
@@ -0,0 +1,199 @@
+#include "Frontend/Parser.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gross/Graph/Reductions/CSE.h"
+#include "gross/Graph/Reductions/Peephole.h"
+#include "gross/Graph/Reductions/ValuePromotion.h"
+#include "gross/Graph/Reductions/MemoryLegalize.h"
+#include "CodeGen/PreMachineLowering.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace gross;
+
+// a program with NumFuncs functions that share globals, constants
+// and call each other
+static std::string MakeProgram(size_t NumFuncs) {
+  std::stringstream SS;
+  SS << "main\n"
+     << "var g0, g1;\n"
+     << "array [ 16 ] ga;\n";
+  for(size_t i = 0; i < NumFuncs; ++i) {
+    SS << "function f" << i << "( x, y );\n"
+       << "var a, b, i;\n"
+       << "{\n"
+       << "  let a <- x + 3 * 4;\n"
+       << "  let b <- y * 8 + g0;\n"
+       << "  let i <- 0;\n"
+       << "  while i < " << (i % 7 + 2) << " do\n"
+       << "    let ga[ i ] <- a * 2 + ga[ 1 ];\n"
+       << "    let a <- a + b * 4 - " << i << ";\n"
+       << "    let i <- i + 1\n"
+       << "  od;\n";
+    if(i)
+      SS << "  let b <- call f" << i - 1 << "( a, b + 1 );\n";
+    SS << "  if b > 5 then\n"
+       << "    let g1 <- b - 1\n"
+       << "  else\n"
+       << "    let g1 <- a + " << (i * 3 + 1) << "\n"
+       << "  fi;\n"
+       << "  return a + ga[ 2 ] * 1 + " << i << "\n"
+       << "};\n";
+  }
+  SS << "{\n"
+     << "  let g0 <- call f" << NumFuncs - 1 << "( 1, 2 );\n"
+     << "  call OutputNum( g0 + g1 )\n"
+     << "}.\n";
+  return SS.str();
+}
+
+// ids, inputs and users of every node in order. Users are sorted
+// since shared nodes only re-link them by id with more than one job
+static std::string DumpNodes(Graph& G) {
+  std::stringstream SS;
+  std::vector<size_t> UserIds;
+  for(auto* N : llvm::make_range(G.node_begin(), G.node_end())) {
+    SS << N->getId() << ":" << N->getOp() << "(";
+    for(auto* Input : N->inputs())
+      SS << Input->getId() << ",";
+    SS << ")[";
+    UserIds.clear();
+    for(auto* User : N->users())
+      UserIds.push_back(User->getId());
+    std::sort(UserIds.begin(), UserIds.end());
+    for(auto Id : UserIds)
+      SS << Id << ",";
+    SS << "]\n";
+  }
+  return SS.str();
+}
+
+// run the pipeline until Pass, which is the only pass using NumJobs,
+// and write its running time followed by the resulting graph to OutFile
+static void RunPipeline(const std::string& Src, const std::string& Pass,
+                        size_t NumJobs, const std::string& OutFile) {
+  Graph G;
+  G.EnableValueNumbering();
+  std::istringstream IS(Src);
+  Parser P(IS, G);
+  if(!P.Parse(true)) return;
+
+  using PassTy = void(*)(Graph&);
+  auto runPass = [&](const char* Name, PassTy Fn) -> bool {
+    if(Pass != Name) {
+      Fn(G);
+      return false;
+    }
+    GraphReducer::SetNumJobs(NumJobs);
+    auto Start = std::chrono::steady_clock::now();
+    Fn(G);
+    double Secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - Start).count();
+    GraphReducer::SetNumJobs(1U);
+
+    std::ofstream OF(OutFile);
+    OF << Secs << "\n";
+    G.dumpGraphviz(OF);
+    OF << DumpNodes(G);
+    return true;
+  };
+
+  runPass("mem2reg", [](Graph& G) {
+    GraphReducer::RunWithEditor<ValuePromotion>(G);
+    GraphReducer::RunWithEditor<MemoryLegalize>(G);
+  });
+  if(runPass("peephole", [](Graph& G) {
+       GraphReducer::RunWithEditor<PeepholeReducer>(G);
+     }))
+    return;
+  runPass("cse", [](Graph& G) {
+    GraphReducer::RunWithEditor<CSEReducer>(G);
+    DLXMemoryLegalize DLXMemLegalize(G);
+    DLXMemLegalize.Run();
+    GraphReducer::RunWithEditor<PeepholeReducer>(G);
+  });
+  runPass("pre-machine-lowering", [](Graph& G) {
+    GraphReducer::RunWithEditor<PreMachineLowering>(G);
+  });
+}
+
+// Some passes, as well as the parser, iterate nodes in the order of
+// their addresses. So every run happens in a process forked from the
+// same state, in which the nodes are created at the same addresses
+// until the pass under test
+static std::vector<std::string> RunForked(const std::string& Src,
+                                          const std::string& Pass,
+                                          const std::vector<size_t>& Jobs,
+                                          std::vector<double>& Secs) {
+  std::vector<std::string> OutFiles;
+  for(auto NumJobs : Jobs)
+    OutFiles.push_back("TestParallelReduction." + Pass + "." +
+                       std::to_string(NumJobs) + ".txt");
+  // don't allocate between forks
+  std::vector<pid_t> Pids(Jobs.size(), -1);
+  // otherwise children will print the buffered output again
+  std::cout.flush();
+  std::fflush(stdout);
+  for(size_t i = 0; i < Jobs.size(); ++i) {
+    Pids[i] = fork();
+    if(!Pids[i]) {
+      RunPipeline(Src, Pass, Jobs[i], OutFiles[i]);
+      _exit(0);
+    }
+  }
+
+  std::vector<std::string> Results;
+  for(size_t i = 0; i < Jobs.size(); ++i) {
+    int Status;
+    if(Pids[i] < 0 || waitpid(Pids[i], &Status, 0) != Pids[i] ||
+       !WIFEXITED(Status) || WEXITSTATUS(Status))
+      continue;
+    std::ifstream IF(OutFiles[i]);
+    double Sec;
+    if(!(IF >> Sec)) continue;
+    std::stringstream SS;
+    SS << IF.rdbuf();
+    Results.push_back(SS.str());
+    Secs.push_back(Sec);
+  }
+  return Results;
+}
+
+// line number of the first difference, 0 if identical
+static size_t FirstDiffLine(const std::string& LHS, const std::string& RHS) {
+  std::istringstream LS(LHS), RS(RHS);
+  std::string LLine, RLine;
+  for(size_t Line = 1U; ; ++Line) {
+    bool HasL = bool(std::getline(LS, LLine)),
+         HasR = bool(std::getline(RS, RLine));
+    if(!HasL && !HasR) return 0U;
+    if(HasL != HasR || LLine != RLine) return Line;
+  }
+}
+
+TEST(ParallelReductionIntegrateTest, TestIdenticalToSerial) {
+  auto Src = MakeProgram(300);
+  const std::vector<size_t> Jobs{1U, 2U, 4U, 8U};
+  for(const char* Pass : {"peephole", "pre-machine-lowering"}) {
+    std::vector<double> Secs;
+    auto Results = RunForked(Src, Pass, Jobs, Secs);
+    ASSERT_EQ(Results.size(), Jobs.size()) << Pass;
+    ASSERT_FALSE(Results[0].empty()) << Pass;
+    for(size_t i = 1U; i < Jobs.size(); ++i) {
+      // don't let gtest diff the whole dump
+      EXPECT_EQ(FirstDiffLine(Results[0], Results[i]), 0U)
+        << Pass << " with " << Jobs[i] << " jobs";
+    }
+    for(size_t i = 0U; i < Jobs.size(); ++i)
+      std::cout << Pass << ": " << Secs[i] << "s with "
+                << Jobs[i] << " jobs\n";
+  }
+}
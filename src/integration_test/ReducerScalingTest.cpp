@@ -0,0 +1,67 @@
+#include "gross/Graph/Graph.h"
+#include "gross/Graph/GraphReducer.h"
+#include "gross/Graph/NodeUtils.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using namespace gross;
+
+namespace {
+struct AddZeroReducer {
+  explicit AddZeroReducer(Node* Zero) : ZeroNode(Zero) {}
+
+  GraphReduction Reduce(Node* N) {
+    if(N->getOp() != IrOpcode::BinAdd) return GraphReduction();
+    if(N->getValueInput(1) == ZeroNode)
+      return GraphReduction(N->getValueInput(0));
+    return GraphReduction();
+  }
+
+  static constexpr
+  const char* name() { return "add-zero-reducer"; }
+
+private:
+  Node* ZeroNode;
+};
+} // end anonymous namespace
+
+// the best of several runs folding a chain of Length '+ 0'
+static double TimeAddZeroChain(size_t Length) {
+  double Best = 0.0;
+  for(int Run = 0; Run < 3; ++Run) {
+    Graph G;
+    auto* Base = NodeBuilder<IrOpcode::ConstantInt>(&G, 7).Build();
+    auto* Zero = NodeBuilder<IrOpcode::ConstantInt>(&G, 0).Build();
+    Node* Chain = Base;
+    for(size_t i = 0; i < Length; ++i) {
+      Chain = new (G) Node(IrOpcode::BinAdd, {Chain, Zero});
+      G.InsertNode(Chain);
+    }
+    auto* Tail = new (G) Node(IrOpcode::BinMul, {Chain, Base});
+    G.InsertNode(Tail);
+    G.AddSubRegion(SubGraph(Tail));
+
+    auto Start = std::chrono::steady_clock::now();
+    GraphReducer::Run<AddZeroReducer>(G, Zero);
+    std::chrono::duration<double> Elapsed
+      = std::chrono::steady_clock::now() - Start;
+    EXPECT_EQ(Tail->getValueInput(0), Base);
+    if(Run == 0 || Elapsed.count() < Best) Best = Elapsed.count();
+  }
+  return Best;
+}
+
+// Only prints the running time, which should grow roughly linearly
+// with the number of nodes. Timing is too noisy on shared
+// machines to be asserted on
+TEST(ReducerScalingIntegrateTest, TestAddZeroChain) {
+  constexpr size_t SmallLength = 2000U, LargeLength = 64000U;
+  double SmallTime = TimeAddZeroChain(SmallLength);
+  double LargeTime = TimeAddZeroChain(LargeLength);
+  std::cout << SmallLength << " nodes: " << SmallTime << "s, "
+            << LargeLength << " nodes: " << LargeTime << "s, ratio "
+            << LargeTime / std::max(SmallTime, 1e-6) << " (linear: "
+            << LargeLength / SmallLength << ")\n";
+}